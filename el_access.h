@@ -0,0 +1,92 @@
+﻿#pragma once
+
+#include <stdint.h>
+#include "el_image.h"
+
+// アクセスルール（get、set、inf）の組み合わせから、プロパティをTelemetry、Property、Commandのどれにするかを決める
+// 変換するときも、ゲートウェイでEPCの変化を送るときも同じ表を使う
+typedef enum dt_if_type {
+	DT_IF_TYPE_NONE,
+	DT_IF_TYPE_TELEMETRY,
+	DT_IF_TYPE_PROPERTY,
+	DT_IF_TYPE_COMMAND,
+} dt_if_type;
+
+#define EL_ACCESS_RULE_COUNT 5				// access_ruleの数
+
+#define EL_ACCESS_STATE_TELEMETRY 0x01		// 状態（state）ならTelemetry、それ以外はProperty
+#define EL_ACCESS_NOTIFY 0x02				// 状態変化時の通知が必須
+
+typedef struct el_access_class {
+	uint8_t ifType;					// dt_if_type
+	bool writable;
+	uint8_t flags;					// EL_ACCESS_xxx
+} el_access_class;
+
+// GetできてSetできないものはTelemetry（通知が必須でなければ状態のみ）、Setのみはコマンド、両方できるものは書き込めるProperty
+// どちらもできないものはDT_IF_TYPE_NONEで、変換しない
+constexpr el_access_class el_classify_access(int getAccess, int setAccess, int infAccess)
+{
+	bool get = (getAccess != ACCESS_RULE_NONE) && (getAccess != ACCESS_RULE_NA);
+	bool set = (setAccess != ACCESS_RULE_NONE) && (setAccess != ACCESS_RULE_NA);
+	uint8_t notify = (infAccess == ACCESS_RULE_REQUIRED) ? EL_ACCESS_NOTIFY : 0;
+
+	if (get && set)
+		return el_access_class{ DT_IF_TYPE_PROPERTY, true, notify };
+	if (set)
+		return el_access_class{ DT_IF_TYPE_COMMAND, false, notify };
+	if (get && (notify != 0))
+		return el_access_class{ DT_IF_TYPE_TELEMETRY, false, notify };
+	if (get)
+		return el_access_class{ DT_IF_TYPE_PROPERTY, false, EL_ACCESS_STATE_TELEMETRY };
+	return el_access_class{ DT_IF_TYPE_NONE, false, notify };
+}
+
+typedef struct el_access_table {
+	el_access_class classes[EL_ACCESS_RULE_COUNT][EL_ACCESS_RULE_COUNT][EL_ACCESS_RULE_COUNT];	// [get][set][inf]
+} el_access_table;
+
+constexpr el_access_table el_make_access_table()
+{
+	el_access_table table = {};
+	for (int get = 0; get < EL_ACCESS_RULE_COUNT; get++) {
+		for (int set = 0; set < EL_ACCESS_RULE_COUNT; set++) {
+			for (int inf = 0; inf < EL_ACCESS_RULE_COUNT; inf++) {
+				table.classes[get][set][inf] = el_classify_access(get, set, inf);
+			}
+		}
+	}
+	return table;
+}
+
+constexpr el_access_table el_access_classes = el_make_access_table();
+
+// 範囲外のアクセスルールは未定義（ACCESS_RULE_NONE）とする
+inline const el_access_class *el_get_access_class(int getAccess, int setAccess, int infAccess)
+{
+	if ((unsigned)getAccess >= EL_ACCESS_RULE_COUNT)
+		getAccess = ACCESS_RULE_NONE;
+	if ((unsigned)setAccess >= EL_ACCESS_RULE_COUNT)
+		setAccess = ACCESS_RULE_NONE;
+	if ((unsigned)infAccess >= EL_ACCESS_RULE_COUNT)
+		infAccess = ACCESS_RULE_NONE;
+
+	return &el_access_classes.classes[getAccess][setAccess][infAccess];
+}
+
+// データの型を合わせて、最終的な種類を決める
+inline dt_if_type el_get_if_type(const el_access_class *access, int dataType)
+{
+	if ((access->flags & EL_ACCESS_STATE_TELEMETRY) && (dataType == DATA_TYPE_STATE))
+		return DT_IF_TYPE_TELEMETRY;
+
+	return (dt_if_type)access->ifType;
+}
+
+// イメージのプロパティの種類。ゲートウェイでEPCの変化をどれで送るかに使う
+inline dt_if_type el_get_property_if_type(const el_image_header *image, const el_image_property *property)
+{
+	const el_image_data *data = (const el_image_data *)el_image_get(image, property->data);
+	return el_get_if_type(el_get_access_class(property->getAccess, property->setAccess, property->infAccess),
+		(data != NULL) ? data->type : DATA_TYPE_NONE);
+}
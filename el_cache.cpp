@@ -0,0 +1,152 @@
+﻿#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <windows.h>
+#include "el_cache.h"
+
+void el_cache_init(el_device_cache *cache, uint32_t eoj)
+{
+	memset(cache, 0, sizeof(*cache));
+	cache->eoj = eoj;
+	cache->release = EL_RELEASE_LATEST;
+}
+
+void el_cache_free(el_device_cache *cache)
+{
+	for (int i = 0; i < _countof(cache->entries); i++) {
+		free(cache->entries[i]);
+		cache->entries[i] = NULL;
+	}
+}
+
+// 値を持つ応答、通知のプロパティか
+static bool has_value(const el_frame_property *property)
+{
+	if (property->pdc == 0)
+		return false;
+
+	switch (property->esv) {
+	case EL_ESV_GET_RES:
+	case EL_ESV_INF:
+	case EL_ESV_INFC:
+	case EL_ESV_GET_SNA:
+		return true;
+	case EL_ESV_SETGET_RES:
+	case EL_ESV_SETGET_SNA:
+		return property->get;
+	default:
+		return false;
+	}
+}
+
+static bool set_entry(el_device_cache *cache, const el_frame_property *property, uint64_t now)
+{
+	el_cache_entry *entry = cache->entries[property->epc];
+
+	if ((entry == NULL) || (entry->capacity < property->pdc)) {
+		entry = (el_cache_entry *)realloc(entry, offsetof(el_cache_entry, edt) + property->pdc);
+		if (entry == NULL)
+			return false;
+		entry->capacity = property->pdc;
+		cache->entries[property->epc] = entry;
+	}
+
+	entry->time = now;
+	entry->pdc = property->pdc;
+	memcpy(entry->edt, property->edt, property->pdc);
+
+	return true;
+}
+
+bool el_cache_update(el_device_cache *cache, const el_image_header *image, const el_frame *frame, uint64_t now)
+{
+	if (el_frame_owner(frame) != cache->eoj)
+		return false;
+
+	el_frame next = *frame;
+	el_frame_property property;
+	el_edt_property batch[16];
+	int batchCount = 0;
+	bool result = true;
+
+	while (el_frame_next(&next, &property)) {
+		if (!has_value(&property))
+			continue;
+
+		if (property.epc == 0x82) {
+			int release = el_frame_release(&property);
+			if (release != EL_RELEASE_LATEST)
+				cache->release = release;
+		}
+
+		if (!set_entry(cache, &property, now))
+			result = false;
+
+		// 係数のプロパティが含まれていれば、係数も更新する
+		if (batchCount == _countof(batch)) {
+			el_edt_update_coefficients(image, el_frame_class_code(cache->eoj), cache->release,
+				batch, batchCount, &cache->coefficients);
+			batchCount = 0;
+		}
+
+		el_edt_property *item = &batch[batchCount++];
+		memset(item, 0, sizeof(*item));
+		item->epc = property.epc;
+		item->pdc = property.pdc;
+		item->edt = property.edt;
+	}
+
+	el_edt_update_coefficients(image, el_frame_class_code(cache->eoj), cache->release,
+		batch, batchCount, &cache->coefficients);
+
+	return result;
+}
+
+bool el_cache_is_fresh(const el_device_cache *cache, const el_image_header *image, int epc, uint64_t now, uint64_t ttl)
+{
+	const el_cache_entry *entry = cache->entries[epc & 0xFF];
+	if (entry == NULL)
+		return false;
+
+	if (now - entry->time <= ttl)
+		return true;
+
+	const el_image_property *property = el_image_find_property(image, el_frame_class_code(cache->eoj), epc, cache->release);
+	return (property != NULL) && (property->infAccess == ACCESS_RULE_REQUIRED);
+}
+
+el_edt_status el_cache_read(el_device_cache *cache, const el_image_header *image, int epc, uint64_t now, uint64_t ttl,
+	el_value *values, int valueCapacity, int *valueCount)
+{
+	*valueCount = 0;
+
+	if (!el_cache_is_fresh(cache, image, epc, now, ttl))
+		return EL_EDT_STALE;
+
+	const el_cache_entry *entry = cache->entries[epc & 0xFF];
+	el_edt_property item;
+	memset(&item, 0, sizeof(item));
+	item.epc = (uint8_t)epc;
+	item.pdc = entry->pdc;
+	item.edt = entry->edt;
+
+	el_edt_status status = el_edt_decode_batch(image, el_frame_class_code(cache->eoj), cache->release, &item, 1,
+		&cache->coefficients, values, valueCapacity, valueCount);
+	if (status != EL_EDT_OK)
+		return status;
+
+	return item.status;
+}
+
+int el_cache_get_stale(const el_device_cache *cache, const el_image_header *image, const uint8_t *epcs, int epcCount,
+	uint64_t now, uint64_t ttl, uint8_t *stale)
+{
+	int count = 0;
+
+	for (int i = 0; i < epcCount; i++) {
+		if (!el_cache_is_fresh(cache, image, epcs[i], now, ttl))
+			stale[count++] = epcs[i];
+	}
+
+	return count;
+}
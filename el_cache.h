@@ -0,0 +1,40 @@
+﻿#pragma once
+
+#include <stdint.h>
+#include "el_frame.h"
+
+// 機器ごとに、受信したプロパティの最後の値（EDT）を覚えておく
+// Get_Res、INFなどで更新し、新しければGet要求を送らずにキャッシュから答える
+// 値はEDTのまま持ち、読むときに変換する（変換した値はイメージとEDTを指すため）
+typedef struct el_cache_entry {
+	uint64_t time;					// 受信した時刻（ミリ秒）
+	uint8_t pdc;
+	uint8_t capacity;				// edtの大きさ
+	uint8_t edt[1];
+} el_cache_entry;
+
+typedef struct el_device_cache {
+	uint32_t eoj;					// 機器オブジェクト（0x028801など）
+	int release;					// 規格Version情報（EPC 0x82）を受信するまではEL_RELEASE_LATEST
+	el_edt_coefficients coefficients;
+	el_cache_entry *entries[256];	// EPCごと。受信していなければNULL
+} el_device_cache;
+
+void el_cache_init(el_device_cache *cache, uint32_t eoj);
+void el_cache_free(el_device_cache *cache);
+
+// フレームのプロパティを持つオブジェクトがこの機器なら、値を持つプロパティで更新する
+// 更新するのはGet_Res、INF、INFC、SetGet_ResのGet側と、不可応答のうち値のあるGet側。Setの要求と不可応答の値は使わない
+bool el_cache_update(el_device_cache *cache, const el_image_header *image, const el_frame *frame, uint64_t now);
+
+// 新しい値を持っているか。ttlより前に受信した値は古いとする
+// ただし状態変化時の通知（inf）が必須のプロパティは、変われば通知されるので受信した値をずっと使う
+bool el_cache_is_fresh(const el_device_cache *cache, const el_image_header *image, int epc, uint64_t now, uint64_t ttl);
+
+// 新しい値があれば変換する。なければEL_EDT_STALEを返すので、Get要求を送る
+el_edt_status el_cache_read(el_device_cache *cache, const el_image_header *image, int epc, uint64_t now, uint64_t ttl,
+	el_value *values, int valueCapacity, int *valueCount);
+
+// epcsのうち、Get要求を送る必要があるものをstaleに入れる。戻り値はその数
+int el_cache_get_stale(const el_device_cache *cache, const el_image_header *image, const uint8_t *epcs, int epcCount,
+	uint64_t now, uint64_t ttl, uint8_t *stale);
@@ -0,0 +1,1062 @@
+﻿#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <windows.h>
+#include "el_edt.h"
+
+typedef struct el_edt_decoder {
+	const el_image_header *image;
+	const el_edt_coefficients *coefficients;
+	el_value *values;
+	int valueCount;
+	int valueCapacity;
+} el_edt_decoder;
+
+// 戻り値は使ったEDTのバイト数、失敗したときはel_edt_statusを負にした値
+static int decode_data(el_edt_decoder *decoder, const el_image_data *data, const char *name,
+	const uint8_t *edt, int length, bool whole);
+
+static el_value *add_value(el_edt_decoder *decoder, el_value_type type, const el_image_data *data, const char *name)
+{
+	if (decoder->valueCount == decoder->valueCapacity)
+		return NULL;
+
+	el_value *value = &decoder->values[decoder->valueCount++];
+	memset(value, 0, sizeof(*value));
+	value->type = (uint8_t)type;
+	value->data = data;
+	value->name = name;
+	value->end = decoder->valueCount;
+
+	return value;
+}
+
+static uint32_t read_uint(const uint8_t *edt, int size)
+{
+	uint32_t value = 0;
+
+	for (int i = 0; i < size; i++) {
+		value = (value << 8) | edt[i];
+	}
+
+	return value;
+}
+
+static int number_size(int numFormat)
+{
+	switch (numFormat) {
+	case NUMBER_FORMAT_INT8:
+	case NUMBER_FORMAT_UINT8:
+		return 1;
+	case NUMBER_FORMAT_INT16:
+	case NUMBER_FORMAT_UINT16:
+		return 2;
+	case NUMBER_FORMAT_INT32:
+	case NUMBER_FORMAT_UINT32:
+		return 4;
+	default:
+		return 0;
+	}
+}
+
+// 係数のEPCの値をすべて掛けた値。どれかがキャッシュになければfalse
+static bool get_coefficient(el_edt_decoder *decoder, const el_image_data *data, double *factor)
+{
+	const el_edt_coefficients *coefficients = decoder->coefficients;
+	if (coefficients == NULL)
+		return false;
+
+	const uint32_t *epcs = (const uint32_t *)el_image_get(decoder->image, data->coefficientEpcs);
+	*factor = 1;
+	for (uint32_t i = 0; i < data->coefficientEpcCount; i++) {
+		int j;
+		for (j = 0; j < coefficients->count; j++) {
+			if (coefficients->epcs[j] == epcs[i])
+				break;
+		}
+		if (j == coefficients->count)
+			return false;
+
+		*factor *= coefficients->factors[j];
+	}
+
+	return true;
+}
+
+static int decode_number(el_edt_decoder *decoder, const el_image_data *data, const char *name,
+	const uint8_t *edt, int length)
+{
+	int size = number_size(data->numFormat);
+	if (size == 0)
+		return -EL_EDT_UNSUPPORTED;
+	if (length < size)
+		return -EL_EDT_BAD_LENGTH;
+
+	uint32_t bits = read_uint(edt, size);
+	int64_t integer;
+	switch (data->numFormat) {
+	case NUMBER_FORMAT_INT8:
+		integer = (int8_t)bits;
+		break;
+	case NUMBER_FORMAT_INT16:
+		integer = (int16_t)bits;
+		break;
+	case NUMBER_FORMAT_INT32:
+		integer = (int32_t)bits;
+		break;
+	default:
+		integer = bits;
+		break;
+	}
+
+	// 範囲を超えた値（0x7E、0xFDなど）は"oneOf"の状態の側で受ける
+	if (((data->minimum != 0) || (data->maximum != 0)) && (data->minimum <= data->maximum)) {
+		if ((integer < data->minimum) || (integer > data->maximum))
+			return -EL_EDT_OUT_OF_RANGE;
+	}
+
+	if (data->numberEnumCount != 0) {
+		const int64_t *item = (const int64_t *)el_image_get(decoder->image, data->numberEnum);
+		uint32_t i;
+		for (i = 0; i < data->numberEnumCount; i++, item++) {
+			if (*item == integer)
+				break;
+		}
+		if (i == data->numberEnumCount)
+			return -EL_EDT_OUT_OF_RANGE;
+	}
+
+	el_value *value = add_value(decoder, EL_VALUE_INTEGER, data, name);
+	if (value == NULL)
+		return -EL_EDT_NO_SPACE;
+
+	value->integer = integer;
+	value->number = (data->multipleOf != 0) ? integer * data->multipleOf : (double)integer;
+
+	if (data->coefficientEpcCount != 0) {
+		double factor;
+		if (get_coefficient(decoder, data, &factor)) {
+			value->number *= factor;
+			value->flags |= EL_VALUE_SCALED;
+		}
+		else {
+			value->flags |= EL_VALUE_NO_COEFFICIENT;
+		}
+	}
+
+	return size;
+}
+
+// stateとnumericValue。bitmapの値はsizeが0なので1バイトとして扱う
+static int decode_state(el_edt_decoder *decoder, const el_image_data *data, const char *name,
+	const uint8_t *edt, int length)
+{
+	int size = (data->size > 0) ? data->size : 1;
+	if (size > 4)
+		return -EL_EDT_UNSUPPORTED;
+	if (length < size)
+		return -EL_EDT_BAD_LENGTH;
+
+	uint32_t bits = read_uint(edt, size);
+	const el_image_edt *edts = (const el_image_edt *)el_image_get(decoder->image, data->edts);
+	const uint8_t *table = (size == 1) ? (const uint8_t *)el_image_get(decoder->image, data->stateTable) : NULL;
+	uint32_t i;
+	if (table != NULL) {
+		i = table[bits];
+		if (i == EL_IMAGE_NO_STATE)
+			return -EL_EDT_OUT_OF_RANGE;
+	}
+	else {
+		for (i = 0; i < data->edtCount; i++) {
+			if ((uint32_t)edts[i].edt == bits)
+				break;
+		}
+		if (i == data->edtCount)
+			return -EL_EDT_OUT_OF_RANGE;
+	}
+
+	el_value *value;
+	if (data->type == DATA_TYPE_STATE) {
+		value = add_value(decoder, EL_VALUE_ENUM, data, name);
+		if (value == NULL)
+			return -EL_EDT_NO_SPACE;
+		value->integer = bits;
+		value->number = bits;
+	}
+	else {
+		value = add_value(decoder, EL_VALUE_NUMBER, data, name);
+		if (value == NULL)
+			return -EL_EDT_NO_SPACE;
+		value->integer = (int64_t)edts[i].numericValue;
+		value->number = edts[i].numericValue;
+	}
+	value->index = (uint16_t)i;
+
+	return size;
+}
+
+// baseの値を1段階目とする
+static int decode_level(el_edt_decoder *decoder, const el_image_data *data, const char *name,
+	const uint8_t *edt, int length)
+{
+	const char *base = el_image_get_string(decoder->image, data->base);
+	if ((base == NULL) || (_strnicmp(base, "0x", 2) != 0))
+		return -EL_EDT_UNSUPPORTED;
+
+	int size = ((int)strlen(&base[2]) + 1) / 2;
+	if ((size < 1) || (size > 4))
+		return -EL_EDT_UNSUPPORTED;
+	if (length < size)
+		return -EL_EDT_BAD_LENGTH;
+
+	int64_t level = (int64_t)read_uint(edt, size) - (int64_t)strtoul(&base[2], NULL, 16) + 1;
+	if ((level < 1) || ((data->maximum > 0) && (level > data->maximum)))
+		return -EL_EDT_OUT_OF_RANGE;
+
+	el_value *value = add_value(decoder, EL_VALUE_INTEGER, data, name);
+	if (value == NULL)
+		return -EL_EDT_NO_SPACE;
+
+	value->integer = level;
+	value->number = (double)level;
+
+	return size;
+}
+
+// 年(2バイト)、月、日、時、分、秒の順。sizeより後ろは省略された値として扱う
+static int decode_date_time(el_edt_decoder *decoder, const el_image_data *data, const char *name,
+	const uint8_t *edt, int length)
+{
+	int size = (data->size > 0) ? data->size : 7;
+	if ((size < 2) || (size > 7))
+		return -EL_EDT_UNSUPPORTED;
+	if (length < size)
+		return -EL_EDT_BAD_LENGTH;
+
+	int year = (int)read_uint(edt, 2);
+	int month = (size > 2) ? edt[2] : 1;
+	int day = (size > 3) ? edt[3] : 1;
+	int hour = (size > 4) ? edt[4] : 0;
+	int minute = (size > 5) ? edt[5] : 0;
+	int second = (size > 6) ? edt[6] : 0;
+	if ((year > 9999) || (month < 1) || (month > 12) || (day < 1) || (day > 31)
+		|| (hour > 23) || (minute > 59) || (second > 59))
+		return -EL_EDT_OUT_OF_RANGE;
+
+	el_value *value = add_value(decoder, EL_VALUE_STRING, data, name);
+	if (value == NULL)
+		return -EL_EDT_NO_SPACE;
+
+	sprintf_s(value->text, "%04d-%02d-%02dT%02d:%02d:%02d", year, month, day, hour, minute, second);
+
+	return size;
+}
+
+// 時、分、秒の順
+static int decode_time(el_edt_decoder *decoder, const el_image_data *data, const char *name,
+	const uint8_t *edt, int length)
+{
+	int size = (data->size > 0) ? data->size : 3;
+	if (size > 3)
+		return -EL_EDT_UNSUPPORTED;
+	if (length < size)
+		return -EL_EDT_BAD_LENGTH;
+
+	int hour = edt[0];
+	int minute = (size > 1) ? edt[1] : 0;
+	int second = (size > 2) ? edt[2] : 0;
+	if ((hour > 23) || (minute > 59) || (second > 59))
+		return -EL_EDT_OUT_OF_RANGE;
+
+	el_value *value = add_value(decoder, EL_VALUE_STRING, data, name);
+	if (value == NULL)
+		return -EL_EDT_NO_SPACE;
+
+	sprintf_s(value->text, "%02d:%02d:%02d", hour, minute, second);
+
+	return size;
+}
+
+static int decode_raw(el_edt_decoder *decoder, const el_image_data *data, const char *name,
+	const uint8_t *edt, int length)
+{
+	int size = length;
+	if ((data->maxSize > 0) && (size > (int)data->maxSize))
+		size = (int)data->maxSize;
+	if (size < (int)data->minSize)
+		return -EL_EDT_BAD_LENGTH;
+
+	el_value *value = add_value(decoder, EL_VALUE_RAW, data, name);
+	if (value == NULL)
+		return -EL_EDT_NO_SPACE;
+
+	value->raw = edt;
+	value->rawLength = size;
+
+	return size;
+}
+
+// 要素の数はEDTの残りの長さで決まる
+static int decode_array(el_edt_decoder *decoder, const el_image_data *data, const char *name,
+	const uint8_t *edt, int length)
+{
+	const el_image_data *items = (const el_image_data *)el_image_get(decoder->image, data->dataInfos);
+	if (items == NULL)
+		return -EL_EDT_UNSUPPORTED;
+
+	el_value *value = add_value(decoder, EL_VALUE_ARRAY, data, name);
+	if (value == NULL)
+		return -EL_EDT_NO_SPACE;
+
+	int used = 0, count = 0;
+	while ((used < length) && ((data->maxItems == 0) || (count < data->maxItems))) {
+		int itemLength = length - used;
+		if (data->itemSize > 0) {
+			if (data->itemSize > itemLength)
+				return -EL_EDT_BAD_LENGTH;
+			itemLength = data->itemSize;
+		}
+
+		int result = decode_data(decoder, items, NULL, &edt[used], itemLength, data->itemSize > 0);
+		if (result <= 0)
+			return (result < 0) ? result : -EL_EDT_UNSUPPORTED;
+
+		used += result;
+		count++;
+	}
+	if (count < data->minItems)
+		return -EL_EDT_BAD_LENGTH;
+
+	value->end = decoder->valueCount;
+
+	return used;
+}
+
+static int decode_object(el_edt_decoder *decoder, const el_image_data *data, const char *name,
+	const uint8_t *edt, int length, bool whole)
+{
+	const el_image_data *field = (const el_image_data *)el_image_get(decoder->image, data->dataInfos);
+
+	el_value *value = add_value(decoder, EL_VALUE_OBJECT, data, name);
+	if (value == NULL)
+		return -EL_EDT_NO_SPACE;
+
+	int used = 0;
+	for (uint32_t i = 0; i < data->dataInfoCount; i++, field++) {
+		bool last = (i + 1 == data->dataInfoCount);
+		int result = decode_data(decoder, field, el_image_get_string(decoder->image, field->name),
+			&edt[used], length - used, whole && last);
+		if (result < 0)
+			return result;
+
+		used += result;
+	}
+
+	value->end = decoder->valueCount;
+
+	return used;
+}
+
+// 各フィールドはindexのバイトからbitMaskのビットを取り出し、1バイトの値として変換する
+static int decode_bitmap(el_edt_decoder *decoder, const el_image_data *data, const char *name,
+	const uint8_t *edt, int length)
+{
+	int size = (data->size > 0) ? data->size : 1;
+	if (length < size)
+		return -EL_EDT_BAD_LENGTH;
+
+	el_value *value = add_value(decoder, EL_VALUE_OBJECT, data, name);
+	if (value == NULL)
+		return -EL_EDT_NO_SPACE;
+
+	// マスクとシフト数は変換時に求めてある
+	const el_image_bitmap *bitmap = (const el_image_bitmap *)el_image_get(decoder->image, data->bitmapInfos);
+	for (uint32_t i = 0; i < data->bitmapInfoCount; i++, bitmap++) {
+		if ((bitmap->index < 0) || (bitmap->index >= size) || (bitmap->mask == 0))
+			return -EL_EDT_UNSUPPORTED;
+
+		uint8_t bits = (uint8_t)((edt[bitmap->index] & bitmap->mask) >> bitmap->shift);
+		int first = decoder->valueCount;
+		int result = decode_data(decoder, &bitmap->value, el_image_get_string(decoder->image, bitmap->name), &bits, 1, true);
+		if (result < 0)
+			return result;
+
+		// bitsはこの関数のローカルなので、EDTを指したままになるrawはフィールドにできない
+		for (int j = first; j < decoder->valueCount; j++) {
+			if (decoder->values[j].type == EL_VALUE_RAW)
+				return -EL_EDT_UNSUPPORTED;
+		}
+	}
+
+	value->end = decoder->valueCount;
+
+	return size;
+}
+
+// 最初に変換できた選択肢を使う
+static int decode_one_of(el_edt_decoder *decoder, const el_image_data *data, const char *name,
+	const uint8_t *edt, int length, bool whole)
+{
+	const el_image_data *alternative = (const el_image_data *)el_image_get(decoder->image, data->dataInfos);
+
+	el_value *value = add_value(decoder, EL_VALUE_OBJECT, data, name);
+	if (value == NULL)
+		return -EL_EDT_NO_SPACE;
+
+	int valueCount = decoder->valueCount;
+	int result = -EL_EDT_UNSUPPORTED;
+	for (uint32_t i = 0; i < data->dataInfoCount; i++, alternative++) {
+		result = decode_data(decoder, alternative, el_image_get_string(decoder->image, alternative->name),
+			edt, length, whole);
+		if (result >= 0) {
+			value->index = (uint16_t)i;
+			value->end = decoder->valueCount;
+			return result;
+		}
+		if (result == -EL_EDT_NO_SPACE)
+			return result;
+
+		decoder->valueCount = valueCount;
+	}
+
+	return result;
+}
+
+static int decode_data(el_edt_decoder *decoder, const el_image_data *data, const char *name,
+	const uint8_t *edt, int length, bool whole)
+{
+	int result;
+
+	switch (data->type) {
+	case DATA_TYPE_STATE:
+	case DATA_TYPE_NUMERIC_VALUE:
+		result = decode_state(decoder, data, name, edt, length);
+		break;
+	case DATA_TYPE_OBJECT:
+		result = decode_object(decoder, data, name, edt, length, whole);
+		break;
+	case DATA_TYPE_DATE_TIME:
+		result = decode_date_time(decoder, data, name, edt, length);
+		break;
+	case DATA_TYPE_TIME:
+		result = decode_time(decoder, data, name, edt, length);
+		break;
+	case DATA_TYPE_RAW:
+		result = decode_raw(decoder, data, name, edt, length);
+		break;
+	case DATA_TYPE_ARRAY:
+		result = decode_array(decoder, data, name, edt, length);
+		break;
+	case DATA_TYPE_BITMAP:
+		result = decode_bitmap(decoder, data, name, edt, length);
+		break;
+	case DATA_TYPE_LEVEL:
+		result = decode_level(decoder, data, name, edt, length);
+		break;
+	case DATA_TYPE_NUMBER:
+		result = decode_number(decoder, data, name, edt, length);
+		break;
+	case DATA_TYPE_ONE_OF:
+		result = decode_one_of(decoder, data, name, edt, length, whole);
+		break;
+	default:
+		result = -EL_EDT_UNSUPPORTED;
+		break;
+	}
+
+	if (whole && (result >= 0) && (result != length))
+		return -EL_EDT_BAD_LENGTH;
+
+	return result;
+}
+
+el_edt_status el_edt_decode(const el_image_header *image, int classCode, int epc, int release, const uint8_t *edt, int pdc,
+	el_value *values, int valueCapacity, int *valueCount)
+{
+	const el_image_property *property = el_image_find_property(image, classCode, epc, release);
+	const el_image_data *data = (property != NULL) ? (const el_image_data *)el_image_get(image, property->data) : NULL;
+	if (data == NULL) {
+		*valueCount = 0;
+		return EL_EDT_UNKNOWN_PROPERTY;
+	}
+
+	return el_edt_decode_data(image, data, edt, pdc, values, valueCapacity, valueCount);
+}
+
+el_edt_status el_edt_decode_data(const el_image_header *image, const el_image_data *data, const uint8_t *edt, int pdc,
+	el_value *values, int valueCapacity, int *valueCount)
+{
+	el_edt_decoder decoder;
+	decoder.image = image;
+	decoder.coefficients = NULL;
+	decoder.values = values;
+	decoder.valueCount = 0;
+	decoder.valueCapacity = valueCapacity;
+
+	int result = decode_data(&decoder, data, NULL, edt, pdc, true);
+	if (result < 0) {
+		*valueCount = 0;
+		return (el_edt_status)-result;
+	}
+
+	*valueCount = decoder.valueCount;
+	return EL_EDT_OK;
+}
+
+// 係数のプロパティの値（numberかnumericValue）をキャッシュに入れる。いっぱいなら入れない
+static void update_coefficient(const el_image_header *image, const el_image_data *data, const el_edt_property *property,
+	el_edt_coefficients *coefficients)
+{
+	el_value values[4];
+	int valueCount;
+	if ((el_edt_decode_data(image, data, property->edt, property->pdc, values, _countof(values), &valueCount) != EL_EDT_OK)
+		|| ((values[0].type != EL_VALUE_INTEGER) && (values[0].type != EL_VALUE_NUMBER)))
+		return;
+
+	int i;
+	for (i = 0; i < coefficients->count; i++) {
+		if (coefficients->epcs[i] == property->epc)
+			break;
+	}
+	if (i == EL_EDT_COEFFICIENT_COUNT)
+		return;
+	if (i == coefficients->count)
+		coefficients->count++;
+
+	coefficients->epcs[i] = property->epc;
+	coefficients->factors[i] = values[0].number;
+}
+
+void el_edt_update_coefficients(const el_image_header *image, int classCode, int release,
+	const el_edt_property *properties, int propertyCount, el_edt_coefficients *coefficients)
+{
+	for (int i = 0; i < propertyCount; i++) {
+		const el_image_property *property = el_image_find_property(image, classCode, properties[i].epc, release);
+		if ((property != NULL) && (property->flags & EL_IMAGE_PROPERTY_COEFFICIENT) && (properties[i].pdc != 0))
+			update_coefficient(image, (const el_image_data *)el_image_get(image, property->data), &properties[i], coefficients);
+	}
+}
+
+el_edt_status el_edt_decode_batch(const el_image_header *image, int classCode, int release,
+	el_edt_property *properties, int propertyCount, el_edt_coefficients *coefficients,
+	el_value *values, int valueCapacity, int *valueCount)
+{
+	// キャッシュがなければ、このバッチの中の係数だけを使う
+	el_edt_coefficients local;
+	if (coefficients == NULL) {
+		memset(&local, 0, sizeof(local));
+		coefficients = &local;
+	}
+
+	el_edt_update_coefficients(image, classCode, release, properties, propertyCount, coefficients);
+
+	el_edt_decoder decoder;
+	decoder.image = image;
+	decoder.coefficients = coefficients;
+	decoder.values = values;
+	decoder.valueCount = 0;
+	decoder.valueCapacity = valueCapacity;
+
+	el_edt_status status = EL_EDT_OK;
+	for (int i = 0; i < propertyCount; i++) {
+		el_edt_property *item = &properties[i];
+		item->firstValue = decoder.valueCount;
+		item->valueCount = 0;
+
+		// Get要求、Set応答などはEDTがない
+		if (item->pdc == 0) {
+			item->status = EL_EDT_OK;
+			continue;
+		}
+
+		const el_image_property *property = el_image_find_property(image, classCode, item->epc, release);
+		const el_image_data *data = (property != NULL) ? (const el_image_data *)el_image_get(image, property->data) : NULL;
+		if (data == NULL) {
+			item->status = EL_EDT_UNKNOWN_PROPERTY;
+			continue;
+		}
+
+		int result = decode_data(&decoder, data, NULL, item->edt, item->pdc, true);
+		if (result < 0) {
+			decoder.valueCount = item->firstValue;
+			item->status = (el_edt_status)-result;
+			if (item->status == EL_EDT_NO_SPACE)
+				status = EL_EDT_NO_SPACE;
+			continue;
+		}
+
+		item->status = EL_EDT_OK;
+		item->valueCount = decoder.valueCount - item->firstValue;
+	}
+
+	*valueCount = decoder.valueCount;
+	return status;
+}
+
+typedef struct el_edt_encoder {
+	const el_image_header *image;
+} el_edt_encoder;
+
+// 戻り値は書き込んだEDTのバイト数、失敗したときはel_edt_statusを負にした値
+static int encode_data(el_edt_encoder *encoder, const el_image_data *data, const JSON_Value *value,
+	uint8_t *edt, int capacity);
+
+static void write_uint(uint8_t *edt, int size, uint32_t value)
+{
+	for (int i = size - 1; i >= 0; i--) {
+		edt[i] = (uint8_t)value;
+		value >>= 8;
+	}
+}
+
+// make_schemaが付けるenumValuesの名前（set_digital_twin_idで変換した名前、なければ"edt%x"）と比べる
+static bool match_enum_name(const char *name, const char *stateEn, int edt)
+{
+	if (stateEn == NULL) {
+		char *end;
+		if ((strncmp(name, "edt", 3) != 0) || (name[3] == '\0'))
+			return false;
+		return (strtoul(&name[3], &end, 16) == (unsigned long)edt) && (*end == '\0');
+	}
+
+	int i;
+	for (i = 0; (stateEn[i] != '\0') && (i < 64); i++) {
+		char c = stateEn[i];
+		if (!(((c >= '0') && (c <= '9')) || (c == '_')
+			|| ((c >= 'A') && (c <= 'Z'))
+			|| ((c >= 'a') && (c <= 'z')))) {
+			c = '_';
+		}
+		if (name[i] != c)
+			return false;
+	}
+
+	return name[i] == '\0';
+}
+
+// 数字の並びを区切り文字に関係なく順に取り出す（"2020-01-15T10:30:00"、"10:30"など）
+static int parse_fields(const char *string, int *fields, int maxFields)
+{
+	int count = 0;
+
+	while ((*string != '\0') && (count < maxFields)) {
+		if ((*string < '0') || (*string > '9')) {
+			string++;
+			continue;
+		}
+
+		int field = 0;
+		for (; (*string >= '0') && (*string <= '9'); string++) {
+			if (field < 100000)
+				field = field * 10 + (*string - '0');
+		}
+		fields[count++] = field;
+	}
+
+	return count;
+}
+
+static int encode_state(el_edt_encoder *encoder, const el_image_data *data, const JSON_Value *value,
+	uint8_t *edt, int capacity)
+{
+	int size = (data->size > 0) ? data->size : 1;
+	if (size > 4)
+		return -EL_EDT_UNSUPPORTED;
+	if (capacity < size)
+		return -EL_EDT_NO_SPACE;
+
+	JSON_Value_Type type = json_value_get_type(value);
+	if ((type != JSONNumber) && ((type != JSONString) || (data->type != DATA_TYPE_STATE)))
+		return -EL_EDT_BAD_VALUE;
+
+	const el_image_edt *edts = (const el_image_edt *)el_image_get(encoder->image, data->edts);
+	uint32_t i;
+	for (i = 0; i < data->edtCount; i++) {
+		if (data->type == DATA_TYPE_NUMERIC_VALUE) {
+			if (edts[i].numericValue == json_value_get_number(value))
+				break;
+		}
+		else if (type == JSONNumber) {
+			if ((double)edts[i].edt == json_value_get_number(value))
+				break;
+		}
+		else {
+			if (match_enum_name(json_value_get_string(value), el_image_get_string(encoder->image, edts[i].stateEn), edts[i].edt))
+				break;
+		}
+	}
+	if (i == data->edtCount)
+		return -EL_EDT_OUT_OF_RANGE;
+
+	write_uint(edt, size, (uint32_t)edts[i].edt);
+
+	return size;
+}
+
+static int encode_number(el_edt_encoder *encoder, const el_image_data *data, const JSON_Value *value,
+	uint8_t *edt, int capacity)
+{
+	int size = number_size(data->numFormat);
+	if (size == 0)
+		return -EL_EDT_UNSUPPORTED;
+	if (capacity < size)
+		return -EL_EDT_NO_SPACE;
+	if (json_value_get_type(value) != JSONNumber)
+		return -EL_EDT_BAD_VALUE;
+
+	// multipleOfの倍数でない値は受け付けない
+	double scaled = json_value_get_number(value);
+	if (data->multipleOf != 0)
+		scaled /= data->multipleOf;
+	double rounded = floor(scaled + 0.5);
+	if (fabs(scaled - rounded) > 1e-6 * ((fabs(scaled) > 1) ? fabs(scaled) : 1))
+		return -EL_EDT_OUT_OF_RANGE;
+
+	double low, high;
+	switch (data->numFormat) {
+	case NUMBER_FORMAT_INT8:
+		low = INT8_MIN;
+		high = INT8_MAX;
+		break;
+	case NUMBER_FORMAT_INT16:
+		low = INT16_MIN;
+		high = INT16_MAX;
+		break;
+	case NUMBER_FORMAT_INT32:
+		low = INT32_MIN;
+		high = INT32_MAX;
+		break;
+	case NUMBER_FORMAT_UINT8:
+		low = 0;
+		high = UINT8_MAX;
+		break;
+	case NUMBER_FORMAT_UINT16:
+		low = 0;
+		high = UINT16_MAX;
+		break;
+	default:
+		low = 0;
+		high = UINT32_MAX;
+		break;
+	}
+	if ((rounded < low) || (rounded > high))
+		return -EL_EDT_OUT_OF_RANGE;
+
+	int64_t integer = (int64_t)rounded;
+	if (((data->minimum != 0) || (data->maximum != 0)) && (data->minimum <= data->maximum)) {
+		if ((integer < data->minimum) || (integer > data->maximum))
+			return -EL_EDT_OUT_OF_RANGE;
+	}
+
+	if (data->numberEnumCount != 0) {
+		const int64_t *item = (const int64_t *)el_image_get(encoder->image, data->numberEnum);
+		uint32_t i;
+		for (i = 0; i < data->numberEnumCount; i++, item++) {
+			if (*item == integer)
+				break;
+		}
+		if (i == data->numberEnumCount)
+			return -EL_EDT_OUT_OF_RANGE;
+	}
+
+	write_uint(edt, size, (uint32_t)integer);
+
+	return size;
+}
+
+static int encode_level(el_edt_encoder *encoder, const el_image_data *data, const JSON_Value *value,
+	uint8_t *edt, int capacity)
+{
+	const char *base = el_image_get_string(encoder->image, data->base);
+	if ((base == NULL) || (_strnicmp(base, "0x", 2) != 0))
+		return -EL_EDT_UNSUPPORTED;
+
+	int size = ((int)strlen(&base[2]) + 1) / 2;
+	if ((size < 1) || (size > 4))
+		return -EL_EDT_UNSUPPORTED;
+	if (capacity < size)
+		return -EL_EDT_NO_SPACE;
+	if (json_value_get_type(value) != JSONNumber)
+		return -EL_EDT_BAD_VALUE;
+
+	double level = json_value_get_number(value);
+	if ((level != floor(level)) || (level < 1) || ((data->maximum > 0) && (level > data->maximum)))
+		return -EL_EDT_OUT_OF_RANGE;
+
+	write_uint(edt, size, (uint32_t)(strtoul(&base[2], NULL, 16) + (uint32_t)level - 1));
+
+	return size;
+}
+
+static int encode_date_time(el_edt_encoder *encoder, const el_image_data *data, const JSON_Value *value,
+	uint8_t *edt, int capacity)
+{
+	int size = (data->size > 0) ? data->size : 7;
+	if ((size < 2) || (size > 7))
+		return -EL_EDT_UNSUPPORTED;
+	if (capacity < size)
+		return -EL_EDT_NO_SPACE;
+	if (json_value_get_type(value) != JSONString)
+		return -EL_EDT_BAD_VALUE;
+
+	// 年、月、日、時、分、秒。sizeに入らない部分は捨てる
+	int fields[6] = { 0, 1, 1, 0, 0, 0 };
+	if (parse_fields(json_value_get_string(value), fields, 6) < ((size > 3) ? 3 : size - 1))
+		return -EL_EDT_BAD_VALUE;
+	if ((fields[0] > 9999) || (fields[1] < 1) || (fields[1] > 12) || (fields[2] < 1) || (fields[2] > 31)
+		|| (fields[3] > 23) || (fields[4] > 59) || (fields[5] > 59))
+		return -EL_EDT_OUT_OF_RANGE;
+
+	write_uint(edt, 2, (uint32_t)fields[0]);
+	for (int i = 2; i < size; i++) {
+		edt[i] = (uint8_t)fields[i - 1];
+	}
+
+	return size;
+}
+
+static int encode_time(el_edt_encoder *encoder, const el_image_data *data, const JSON_Value *value,
+	uint8_t *edt, int capacity)
+{
+	int size = (data->size > 0) ? data->size : 3;
+	if (size > 3)
+		return -EL_EDT_UNSUPPORTED;
+	if (capacity < size)
+		return -EL_EDT_NO_SPACE;
+	if (json_value_get_type(value) != JSONString)
+		return -EL_EDT_BAD_VALUE;
+
+	int fields[3] = { 0, 0, 0 };
+	if (parse_fields(json_value_get_string(value), fields, 3) < size)
+		return -EL_EDT_BAD_VALUE;
+	if ((fields[0] > 23) || (fields[1] > 59) || (fields[2] > 59))
+		return -EL_EDT_OUT_OF_RANGE;
+
+	for (int i = 0; i < size; i++) {
+		edt[i] = (uint8_t)fields[i];
+	}
+
+	return size;
+}
+
+// rawは16進数の文字列で受け取る
+static int encode_raw(el_edt_encoder *encoder, const el_image_data *data, const JSON_Value *value,
+	uint8_t *edt, int capacity)
+{
+	const char *string = json_value_get_string(value);
+	if (string == NULL)
+		return -EL_EDT_BAD_VALUE;
+
+	size_t length = strlen(string);
+	if ((length % 2) != 0)
+		return -EL_EDT_BAD_VALUE;
+
+	int size = (int)(length / 2);
+	if ((size < (int)data->minSize) || ((data->maxSize > 0) && (size > (int)data->maxSize)))
+		return -EL_EDT_OUT_OF_RANGE;
+	if (capacity < size)
+		return -EL_EDT_NO_SPACE;
+
+	for (int i = 0; i < size; i++) {
+		int digits[2];
+		for (int j = 0; j < 2; j++) {
+			char c = string[i * 2 + j];
+			if ((c >= '0') && (c <= '9'))
+				digits[j] = c - '0';
+			else if ((c >= 'A') && (c <= 'F'))
+				digits[j] = c - 'A' + 10;
+			else if ((c >= 'a') && (c <= 'f'))
+				digits[j] = c - 'a' + 10;
+			else
+				return -EL_EDT_BAD_VALUE;
+		}
+		edt[i] = (uint8_t)((digits[0] << 4) | digits[1]);
+	}
+
+	return size;
+}
+
+static int encode_array(el_edt_encoder *encoder, const el_image_data *data, const JSON_Value *value,
+	uint8_t *edt, int capacity)
+{
+	const el_image_data *items = (const el_image_data *)el_image_get(encoder->image, data->dataInfos);
+	if (items == NULL)
+		return -EL_EDT_UNSUPPORTED;
+
+	JSON_Array *array = json_value_get_array(value);
+	if (array == NULL)
+		return -EL_EDT_BAD_VALUE;
+
+	int count = (int)json_array_get_count(array);
+	if ((count < data->minItems) || ((data->maxItems > 0) && (count > data->maxItems)))
+		return -EL_EDT_OUT_OF_RANGE;
+
+	int used = 0;
+	for (int i = 0; i < count; i++) {
+		int result = encode_data(encoder, items, json_array_get_value(array, i), &edt[used], capacity - used);
+		if (result < 0)
+			return result;
+		if ((data->itemSize > 0) && (result != data->itemSize))
+			return -EL_EDT_BAD_VALUE;
+
+		used += result;
+	}
+
+	return used;
+}
+
+static int encode_object(el_edt_encoder *encoder, const el_image_data *data, const JSON_Value *value,
+	uint8_t *edt, int capacity)
+{
+	JSON_Object *object = json_value_get_object(value);
+	if (object == NULL)
+		return -EL_EDT_BAD_VALUE;
+
+	const el_image_data *field = (const el_image_data *)el_image_get(encoder->image, data->dataInfos);
+	int used = 0;
+	for (uint32_t i = 0; i < data->dataInfoCount; i++, field++) {
+		const char *name = el_image_get_string(encoder->image, field->name);
+		JSON_Value *fieldValue = (name != NULL) ? json_object_get_value(object, name) : NULL;
+		if (fieldValue == NULL)
+			return -EL_EDT_BAD_VALUE;
+
+		int result = encode_data(encoder, field, fieldValue, &edt[used], capacity - used);
+		if (result < 0)
+			return result;
+
+		used += result;
+	}
+
+	return used;
+}
+
+// 各フィールドを1バイトの値に変換し、indexのバイトのbitMaskの位置に入れる
+static int encode_bitmap(el_edt_encoder *encoder, const el_image_data *data, const JSON_Value *value,
+	uint8_t *edt, int capacity)
+{
+	int size = (data->size > 0) ? data->size : 1;
+	if (capacity < size)
+		return -EL_EDT_NO_SPACE;
+
+	JSON_Object *object = json_value_get_object(value);
+	if (object == NULL)
+		return -EL_EDT_BAD_VALUE;
+
+	memset(edt, 0, size);
+
+	const el_image_bitmap *bitmap = (const el_image_bitmap *)el_image_get(encoder->image, data->bitmapInfos);
+	for (uint32_t i = 0; i < data->bitmapInfoCount; i++, bitmap++) {
+		if ((bitmap->index < 0) || (bitmap->index >= size) || (bitmap->mask == 0))
+			return -EL_EDT_UNSUPPORTED;
+
+		const char *name = el_image_get_string(encoder->image, bitmap->name);
+		JSON_Value *fieldValue = (name != NULL) ? json_object_get_value(object, name) : NULL;
+		if (fieldValue == NULL)
+			return -EL_EDT_BAD_VALUE;
+
+		uint8_t bits;
+		int result = encode_data(encoder, &bitmap->value, fieldValue, &bits, 1);
+		if (result < 0)
+			return result;
+		if (((unsigned)bits << bitmap->shift) & ~(unsigned)bitmap->mask)
+			return -EL_EDT_OUT_OF_RANGE;
+
+		edt[bitmap->index] |= (uint8_t)(bits << bitmap->shift);
+	}
+
+	return size;
+}
+
+// 最初に変換できた選択肢を使う。選択肢に名前があれば、その名前のフィールドの値も受け付ける
+static int encode_one_of(el_edt_encoder *encoder, const el_image_data *data, const JSON_Value *value,
+	uint8_t *edt, int capacity)
+{
+	const el_image_data *alternative = (const el_image_data *)el_image_get(encoder->image, data->dataInfos);
+	JSON_Object *object = json_value_get_object(value);
+	int status = -EL_EDT_UNSUPPORTED;
+
+	for (uint32_t i = 0; i < data->dataInfoCount; i++, alternative++) {
+		const JSON_Value *alternativeValue = value;
+		const char *name = el_image_get_string(encoder->image, alternative->name);
+		if ((object != NULL) && (name != NULL) && (json_object_get_value(object, name) != NULL))
+			alternativeValue = json_object_get_value(object, name);
+
+		int result = encode_data(encoder, alternative, alternativeValue, edt, capacity);
+		if (result >= 0)
+			return result;
+		if (result == -EL_EDT_NO_SPACE)
+			return result;
+
+		// 最初の選択肢の理由を返す
+		if (i == 0)
+			status = result;
+	}
+
+	return status;
+}
+
+static int encode_data(el_edt_encoder *encoder, const el_image_data *data, const JSON_Value *value,
+	uint8_t *edt, int capacity)
+{
+	if (value == NULL)
+		return -EL_EDT_BAD_VALUE;
+
+	switch (data->type) {
+	case DATA_TYPE_STATE:
+	case DATA_TYPE_NUMERIC_VALUE:
+		return encode_state(encoder, data, value, edt, capacity);
+	case DATA_TYPE_OBJECT:
+		return encode_object(encoder, data, value, edt, capacity);
+	case DATA_TYPE_DATE_TIME:
+		return encode_date_time(encoder, data, value, edt, capacity);
+	case DATA_TYPE_TIME:
+		return encode_time(encoder, data, value, edt, capacity);
+	case DATA_TYPE_RAW:
+		return encode_raw(encoder, data, value, edt, capacity);
+	case DATA_TYPE_ARRAY:
+		return encode_array(encoder, data, value, edt, capacity);
+	case DATA_TYPE_BITMAP:
+		return encode_bitmap(encoder, data, value, edt, capacity);
+	case DATA_TYPE_LEVEL:
+		return encode_level(encoder, data, value, edt, capacity);
+	case DATA_TYPE_NUMBER:
+		return encode_number(encoder, data, value, edt, capacity);
+	case DATA_TYPE_ONE_OF:
+		return encode_one_of(encoder, data, value, edt, capacity);
+	default:
+		return -EL_EDT_UNSUPPORTED;
+	}
+}
+
+el_edt_status el_edt_encode(const el_image_header *image, int classCode, int epc, int release, const JSON_Value *value,
+	uint8_t *edt, int edtCapacity, int *pdc)
+{
+	*pdc = 0;
+
+	const el_image_property *property = el_image_find_property(image, classCode, epc, release);
+	const el_image_data *data = (property != NULL) ? (const el_image_data *)el_image_get(image, property->data) : NULL;
+	if (data == NULL)
+		return EL_EDT_UNKNOWN_PROPERTY;
+
+	if ((property->setAccess == ACCESS_RULE_NONE) || (property->setAccess == ACCESS_RULE_NA))
+		return EL_EDT_NOT_WRITABLE;
+
+	return el_edt_encode_data(image, data, value, edt, edtCapacity, pdc);
+}
+
+el_edt_status el_edt_encode_data(const el_image_header *image, const el_image_data *data, const JSON_Value *value,
+	uint8_t *edt, int edtCapacity, int *pdc)
+{
+	el_edt_encoder encoder;
+	encoder.image = image;
+
+	int result = encode_data(&encoder, data, value, edt, edtCapacity);
+	if (result < 0) {
+		*pdc = 0;
+		return (el_edt_status)-result;
+	}
+
+	*pdc = result;
+	return EL_EDT_OK;
+}
@@ -0,0 +1,91 @@
+﻿#pragma once
+
+#include <stdint.h>
+#include "el_image.h"
+#include "parson.h"
+
+// イメージのデータ定義に従ってEDTを値に変換する
+// 値はmake_schemaが出力するスキーマの形で、呼び出し側が用意した配列に深さ優先の順に並べる（メモリは確保しない）
+typedef enum el_edt_status {
+	EL_EDT_OK,
+	EL_EDT_UNKNOWN_PROPERTY,	// 機器定義にないプロパティ
+	EL_EDT_BAD_LENGTH,			// EDTの長さが定義と合わない
+	EL_EDT_OUT_OF_RANGE,		// 範囲外、列挙値にない
+	EL_EDT_UNSUPPORTED,			// 変換できない定義
+	EL_EDT_NO_SPACE,			// 値の配列、EDTのバッファが足りない
+	EL_EDT_BAD_VALUE,			// 値の型が定義と合わない
+	EL_EDT_NOT_WRITABLE,		// SETできないプロパティ
+	EL_EDT_STALE,				// キャッシュに新しい値がない
+} el_edt_status;
+
+typedef enum el_value_type {
+	EL_VALUE_NONE,
+	EL_VALUE_INTEGER,			// number, level
+	EL_VALUE_NUMBER,			// numericValue
+	EL_VALUE_ENUM,				// state
+	EL_VALUE_STRING,			// date_time, time
+	EL_VALUE_RAW,				// raw
+	EL_VALUE_OBJECT,			// object, bitmap, one_of
+	EL_VALUE_ARRAY,				// array
+} el_value_type;
+
+typedef struct el_value {
+	uint8_t type;				// el_value_type
+	uint8_t flags;				// EL_VALUE_*
+	uint16_t index;				// 列挙値の番号、one_ofで選んだ選択肢の番号
+	int32_t end;				// 子を含めた、次の兄弟の位置
+	const el_image_data *data;	// 値の定義
+	const char *name;			// object, bitmapのフィールド名
+	int64_t integer;			// EDTの値（levelは段階）
+	double number;				// multipleOfを掛けた値、numericValueの値
+	const uint8_t *raw;			// rawはEDTの中を指す
+	int32_t rawLength;
+	char text[20];				// date_timeは"YYYY-MM-DDThh:mm:ss"、timeは"hh:mm:ss"
+} el_value;
+
+#define EL_VALUE_SCALED 0x01			// numberに係数を掛けてある
+#define EL_VALUE_NO_COEFFICIENT 0x02	// 係数のプロパティの値が分からないので、numberに係数を掛けていない
+
+// 機器ごとの係数（積算電力量単位など）のキャッシュ。係数のプロパティを受信したときに更新する
+#define EL_EDT_COEFFICIENT_COUNT 8
+
+typedef struct el_edt_coefficients {
+	int count;
+	uint8_t epcs[EL_EDT_COEFFICIENT_COUNT];
+	double factors[EL_EDT_COEFFICIENT_COUNT];
+} el_edt_coefficients;
+
+// まとめて変換するプロパティ。status、firstValue、valueCountに結果を返す
+typedef struct el_edt_property {
+	uint8_t epc;
+	uint8_t pdc;
+	uint16_t reserved;
+	el_edt_status status;
+	const uint8_t *edt;
+	int32_t firstValue;
+	int32_t valueCount;
+} el_edt_property;
+
+// releaseは機器のリリース（'A'〜、EPC 0x82で分かる）。EL_RELEASE_LATESTなら最新の定義を使う
+el_edt_status el_edt_decode(const el_image_header *image, int classCode, int epc, int release, const uint8_t *edt, int pdc,
+	el_value *values, int valueCapacity, int *valueCount);
+el_edt_status el_edt_decode_data(const el_image_header *image, const el_image_data *data, const uint8_t *edt, int pdc,
+	el_value *values, int valueCapacity, int *valueCount);
+
+// バッチの中の係数のプロパティでcoefficientsを更新する
+void el_edt_update_coefficients(const el_image_header *image, int classCode, int release,
+	const el_edt_property *properties, int propertyCount, el_edt_coefficients *coefficients);
+
+// 1つの機器のプロパティ（Get_Res、INFのフレームなど）をまとめて変換する
+// 先にバッチの中の係数のプロパティでcoefficientsを更新し、係数を使うnumberはそれを掛けた値にする
+// 戻り値は値の配列が足りなかったときだけEL_EDT_NO_SPACE。それ以外の失敗はプロパティごとのstatusに返す
+el_edt_status el_edt_decode_batch(const el_image_header *image, int classCode, int release,
+	el_edt_property *properties, int propertyCount, el_edt_coefficients *coefficients,
+	el_value *values, int valueCapacity, int *valueCount);
+
+// DTDLのコマンド、書き込み可能なプロパティの値（JSON）をEDTに変換する。値は変換したときと同じ形で受け取る
+// numberはmultipleOfを掛けた値、stateは列挙値（EDTの値）かenumValuesの名前で指定する
+el_edt_status el_edt_encode(const el_image_header *image, int classCode, int epc, int release, const JSON_Value *value,
+	uint8_t *edt, int edtCapacity, int *pdc);
+el_edt_status el_edt_encode_data(const el_image_header *image, const el_image_data *data, const JSON_Value *value,
+	uint8_t *edt, int edtCapacity, int *pdc);
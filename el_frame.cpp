@@ -0,0 +1,146 @@
+﻿#include <string.h>
+#include <windows.h>
+#include "el_frame.h"
+
+static bool is_set_get(int esv)
+{
+	return (esv == EL_ESV_SETGET) || (esv == EL_ESV_SETGET_RES) || (esv == EL_ESV_SETGET_SNA);
+}
+
+// 要求（0x6x）は相手のオブジェクト、応答と通知は送信元のオブジェクトのプロパティ
+static bool is_request(int esv)
+{
+	return (esv & 0xF0) == 0x60;
+}
+
+static uint32_t read_eoj(const uint8_t *data)
+{
+	return ((uint32_t)data[0] << 16) | ((uint32_t)data[1] << 8) | data[2];
+}
+
+// count個のプロパティを読み飛ばし、次の位置を返す。足りなければNULL
+static const uint8_t *skip_properties(const uint8_t *pos, const uint8_t *end, int count)
+{
+	for (int i = 0; i < count; i++) {
+		if (end - pos < 2)
+			return NULL;
+		int pdc = pos[1];
+		pos += 2;
+		if (end - pos < pdc)
+			return NULL;
+		pos += pdc;
+	}
+
+	return pos;
+}
+
+el_frame_status el_frame_parse(const uint8_t *data, int length, el_frame *frame)
+{
+	memset(frame, 0, sizeof(*frame));
+
+	if ((length < 2) || (data[0] != EL_FRAME_EHD1))
+		return EL_FRAME_BAD_HEADER;
+	if (data[1] != EL_FRAME_EHD2)
+		return (data[1] == 0x82) ? EL_FRAME_UNSUPPORTED : EL_FRAME_BAD_HEADER;
+	if (length < EL_FRAME_HEADER_SIZE)
+		return EL_FRAME_BAD_LENGTH;
+
+	frame->tid = (uint16_t)((data[2] << 8) | data[3]);
+	frame->seoj = read_eoj(&data[4]);
+	frame->deoj = read_eoj(&data[7]);
+	frame->esv = data[10];
+	frame->opc = data[11];
+
+	const uint8_t *end = data + length;
+	const uint8_t *pos = skip_properties(&data[EL_FRAME_HEADER_SIZE], end, frame->opc);
+	if (pos == NULL)
+		return EL_FRAME_BAD_LENGTH;
+
+	if (is_set_get(frame->esv)) {
+		if (pos == end)
+			return EL_FRAME_BAD_LENGTH;
+		frame->opcGet = *pos++;
+		pos = skip_properties(pos, end, frame->opcGet);
+		if (pos == NULL)
+			return EL_FRAME_BAD_LENGTH;
+	}
+
+	if (pos != end)
+		return EL_FRAME_BAD_LENGTH;
+
+	frame->next = &data[EL_FRAME_HEADER_SIZE];
+	frame->remaining = frame->opc + frame->opcGet;
+
+	return EL_FRAME_OK;
+}
+
+bool el_frame_next(el_frame *frame, el_frame_property *property)
+{
+	if (frame->remaining == 0)
+		return false;
+
+	// SetGetはOPCSetのプロパティの後にOPCGetがある
+	bool get = frame->remaining <= frame->opcGet;
+	if (get && (frame->remaining == frame->opcGet) && (frame->opcGet != 0))
+		frame->next++;
+
+	property->eoj = el_frame_owner(frame);
+	property->esv = frame->esv;
+	property->epc = frame->next[0];
+	property->pdc = frame->next[1];
+	property->get = get;
+	property->edt = &frame->next[2];
+
+	frame->next += 2 + property->pdc;
+	frame->remaining--;
+
+	return true;
+}
+
+// プロパティを持つオブジェクト
+uint32_t el_frame_owner(const el_frame *frame)
+{
+	return is_request(frame->esv) ? frame->deoj : frame->seoj;
+}
+
+el_edt_status el_frame_decode(const el_image_header *image, int release, const el_frame_property *property,
+	el_value *values, int valueCapacity, int *valueCount)
+{
+	*valueCount = 0;
+
+	// Get要求、Set応答などはEDTがない
+	if (property->pdc == 0)
+		return EL_EDT_OK;
+
+	return el_edt_decode(image, el_frame_class_code(property->eoj), property->epc, release, property->edt, property->pdc,
+		values, valueCapacity, valueCount);
+}
+
+int el_frame_get_properties(el_frame *frame, el_edt_property *properties, int capacity)
+{
+	el_frame_property property;
+	int count = 0;
+
+	while ((count < capacity) && el_frame_next(frame, &property)) {
+		el_edt_property *item = &properties[count++];
+		memset(item, 0, sizeof(*item));
+		item->epc = property.epc;
+		item->pdc = property.pdc;
+		item->edt = property.edt;
+	}
+
+	return count;
+}
+
+// 機器オブジェクトの規格Version情報は"0x00, 0x00, リリース, 0x00"。ノードプロファイルはプロトコルのバージョン
+int el_frame_release(const el_frame_property *property)
+{
+	if ((property->epc != 0x82) || (property->pdc != 4) || (el_frame_class_code(property->eoj) == 0x0EF0))
+		return EL_RELEASE_LATEST;
+
+	int release = property->edt[2];
+	if ((release < 'A') || (release > 'Z'))
+		return EL_RELEASE_LATEST;
+
+	return release;
+}
@@ -0,0 +1,76 @@
+﻿#pragma once
+
+#include <stdint.h>
+#include "el_edt.h"
+
+// 受信したECHONET Liteフレーム（UDPのペイロード）をその場で読む
+// 最初に全体の長さを確かめ、プロパティはフレームの中を指したまま順に取り出す（コピーしない）
+#define EL_FRAME_EHD1 0x10
+#define EL_FRAME_EHD2 0x81			// 規定電文形式
+#define EL_FRAME_HEADER_SIZE 12		// EHD、TID、SEOJ、DEOJ、ESV、OPC
+
+typedef enum el_esv {
+	EL_ESV_SETI_SNA = 0x50,
+	EL_ESV_SETC_SNA = 0x51,
+	EL_ESV_GET_SNA = 0x52,
+	EL_ESV_INF_SNA = 0x53,
+	EL_ESV_SETGET_SNA = 0x5E,
+	EL_ESV_SETI = 0x60,
+	EL_ESV_SETC = 0x61,
+	EL_ESV_GET = 0x62,
+	EL_ESV_INF_REQ = 0x63,
+	EL_ESV_SETGET = 0x6E,
+	EL_ESV_SET_RES = 0x71,
+	EL_ESV_GET_RES = 0x72,
+	EL_ESV_INF = 0x73,
+	EL_ESV_INFC = 0x74,
+	EL_ESV_INFC_RES = 0x7A,
+	EL_ESV_SETGET_RES = 0x7E,
+} el_esv;
+
+typedef enum el_frame_status {
+	EL_FRAME_OK,
+	EL_FRAME_BAD_HEADER,			// EHDが違う
+	EL_FRAME_UNSUPPORTED,			// 任意電文形式
+	EL_FRAME_BAD_LENGTH,			// OPC、PDCがフレームの長さと合わない
+} el_frame_status;
+
+typedef struct el_frame {
+	uint16_t tid;
+	uint8_t esv;					// el_esv
+	uint8_t opc;					// SetGetはOPCSet
+	uint8_t opcGet;					// SetGetのOPCGet、それ以外は0
+	uint8_t reserved[3];
+	uint32_t seoj;					// クラスグループコード、クラスコード、インスタンスコード（0x013001など）
+	uint32_t deoj;
+	const uint8_t *next;			// 次に読むEPC
+	int remaining;					// 残りのプロパティ数（SetGetのGet側を含む）
+} el_frame;
+
+typedef struct el_frame_property {
+	uint32_t eoj;					// プロパティを持つオブジェクト。要求はDEOJ、応答と通知はSEOJ
+	uint8_t esv;
+	uint8_t epc;
+	uint8_t pdc;
+	bool get;						// SetGetのGet側
+	const uint8_t *edt;				// フレームの中を指す
+} el_frame_property;
+
+el_frame_status el_frame_parse(const uint8_t *data, int length, el_frame *frame);
+bool el_frame_next(el_frame *frame, el_frame_property *property);
+uint32_t el_frame_owner(const el_frame *frame);
+
+// プロパティを持つオブジェクトのクラスコードで機器定義を引いてEDTを変換する。PDCが0なら値はない
+el_edt_status el_frame_decode(const el_image_header *image, int release, const el_frame_property *property,
+	el_value *values, int valueCapacity, int *valueCount);
+
+// 残りのプロパティをel_edt_decode_batchに渡す形で取り出す。戻り値は取り出した数
+int el_frame_get_properties(el_frame *frame, el_edt_property *properties, int capacity);
+
+// 規格Version情報（EPC 0x82）から機器のリリース（'A'〜）を取り出す。ほかのプロパティ、ノードプロファイルは0
+int el_frame_release(const el_frame_property *property);
+
+inline int el_frame_class_code(uint32_t eoj)
+{
+	return (int)(eoj >> 8);
+}
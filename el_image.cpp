@@ -0,0 +1,470 @@
+﻿#include <stdlib.h>
+#include <string.h>
+#include <windows.h>
+#include "el_image.h"
+
+#define EL_IMAGE_ALIGN(n) (((n) + 7) & ~(uint32_t)7)
+
+typedef struct el_image_shared {
+	const void *source;
+	uint32_t offset;
+} el_image_shared;
+
+const el_image_header *el_image_open(const char *filename)
+{
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return NULL;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || (size.QuadPart < (long long)sizeof(el_image_header)) || (size.QuadPart > UINT32_MAX)) {
+		CloseHandle(file);
+		return NULL;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (mapping == NULL)
+		return NULL;
+
+	// ビューがマッピングを保持する
+	const el_image_header *image = (const el_image_header *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (image == NULL)
+		return NULL;
+
+	uint64_t definitionsEnd = (uint64_t)image->definitions + (uint64_t)image->definitionCount * sizeof(el_image_definition);
+	uint64_t devicesEnd = (uint64_t)image->devices + (uint64_t)image->deviceCount * sizeof(el_image_device);
+	uint64_t indexEnd = (uint64_t)image->propertyIndex + 256 * sizeof(uint32_t);
+	uint64_t superClassEnd = (uint64_t)image->superClassProperties + 256 * sizeof(uint32_t);
+	if ((memcmp(image->magic, EL_IMAGE_MAGIC, sizeof(image->magic)) != 0)
+		|| (image->version != EL_IMAGE_VERSION)
+		|| (image->size != (uint32_t)size.QuadPart)
+		|| (definitionsEnd > image->size) || (devicesEnd > image->size)
+		|| (image->propertyIndex == 0) || (indexEnd > image->size) || (superClassEnd > image->size)) {
+		UnmapViewOfFile(image);
+		return NULL;
+	}
+
+	return image;
+}
+
+void el_image_close(const el_image_header *image)
+{
+	if (image != NULL)
+		UnmapViewOfFile(image);
+}
+
+const el_image_definition *el_image_find_definition(const el_image_header *image, const char *name)
+{
+	const el_image_definition *definitions = (const el_image_definition *)el_image_get(image, image->definitions);
+	int lo = 0, hi = (int)image->definitionCount;
+
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		int cmp = strcmp(el_image_get_string(image, definitions[mid].name), name);
+		if (cmp == 0)
+			return &definitions[mid];
+		if (cmp < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return NULL;
+}
+
+// 同じクラスコードの機器が複数あるときは最初のもの
+const el_image_device *el_image_find_device(const el_image_header *image, int classCode)
+{
+	const el_image_device *devices = (const el_image_device *)el_image_get(image, image->devices);
+	int lo = 0, hi = (int)image->deviceCount;
+
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (devices[mid].classCode < classCode)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if ((lo == (int)image->deviceCount) || (devices[lo].classCode != classCode))
+		return NULL;
+
+	return &devices[lo];
+}
+
+// 機器にないときはスーパークラス（0x0000）から探す。プロファイルはスーパークラスから探さない
+// 同じEPCが複数あるときは、releaseで有効なもののうち付録で後にあるもの。最新なら索引にあるもの
+// 索引は変換時に作ってあるので、表を3回引き、あとは選択肢ごとにビットを見るだけ
+const el_image_property *el_image_find_property(const el_image_header *image, int classCode, int epc, int release)
+{
+	if (((unsigned)classCode > 0xFFFF) || ((unsigned)epc > 0xFF))
+		return NULL;
+
+	const uint32_t *groups = (const uint32_t *)el_image_get(image, image->propertyIndex);
+	const uint32_t *classes = (const uint32_t *)el_image_get(image, groups[classCode >> 8]);
+	const uint32_t *epcs = (classes != NULL) ? (const uint32_t *)el_image_get(image, classes[classCode & 0xFF]) : NULL;
+	if ((epcs == NULL) && el_image_has_super_class(classCode))
+		epcs = (const uint32_t *)el_image_get(image, image->superClassProperties);
+	if (epcs == NULL)
+		return NULL;
+
+	const el_image_property *property = (const el_image_property *)el_image_get(image, epcs[epc]);
+	if (release == EL_RELEASE_LATEST)
+		return property;
+
+	uint32_t bit = el_image_release_bit(release);
+	while ((property != NULL) && ((property->validReleases & bit) == 0))
+		property = (const el_image_property *)el_image_get(image, property->alternative);
+
+	return property;
+}
+
+uint32_t el_image_release_mask(const char *from, const char *to)
+{
+	int first = ((from != NULL) && (from[0] >= 'A') && (from[0] <= 'Z')) ? from[0] - 'A' : 0;
+	int last = ((to != NULL) && (to[0] >= 'A') && (to[0] <= 'Z') && (to[1] == '\0')) ? to[0] - 'A' : 31;
+	if (first > last)
+		return 0;
+
+	uint32_t upper = (last == 31) ? UINT32_MAX : ((1u << (last + 1)) - 1);
+	return upper & ~((1u << first) - 1);
+}
+
+bool el_image_builder_init(el_image_builder *builder)
+{
+	memset(builder, 0, sizeof(*builder));
+
+	// オフセット0はヘッダーなので、0を「なし」に使える
+	el_image_alloc(builder, sizeof(el_image_header));
+	if (builder->failed)
+		return false;
+
+	el_image_header *header = (el_image_header *)builder->data;
+	memcpy(header->magic, EL_IMAGE_MAGIC, sizeof(header->magic));
+	header->version = EL_IMAGE_VERSION;
+
+	return true;
+}
+
+void el_image_builder_free(el_image_builder *builder)
+{
+	free(builder->data);
+	free(builder->strings);
+	free(builder->shared);
+	free(builder->devices);
+	memset(builder, 0, sizeof(*builder));
+}
+
+// 0で埋めた領域を確保する。以前に返したポインタは無効になるので、オフセットで持つこと
+uint32_t el_image_alloc(el_image_builder *builder, uint32_t size)
+{
+	uint32_t offset = EL_IMAGE_ALIGN(builder->size);
+	uint64_t end = (uint64_t)offset + size;
+	if (builder->failed || (end > UINT32_MAX)) {
+		builder->failed = true;
+		return 0;
+	}
+
+	if (end > builder->capacity) {
+		uint64_t capacity = (builder->capacity == 0) ? 65536 : builder->capacity;
+		while (capacity < end)
+			capacity *= 2;
+		if (capacity > UINT32_MAX)
+			capacity = UINT32_MAX;
+
+		char *data = (char *)realloc(builder->data, (size_t)capacity);
+		if (data == NULL) {
+			builder->failed = true;
+			return 0;
+		}
+		builder->data = data;
+		builder->capacity = (uint32_t)capacity;
+	}
+
+	memset(&builder->data[builder->size], 0, (size_t)(end - builder->size));
+	builder->size = (uint32_t)end;
+
+	return offset;
+}
+
+// 0はヘッダー
+void *el_image_at(el_image_builder *builder, uint32_t offset)
+{
+	if (builder->failed)
+		return NULL;
+
+	return &builder->data[offset];
+}
+
+static uint32_t hash_string(const char *string)
+{
+	uint32_t hash = 2166136261u;
+
+	for (; *string != '\0'; string++) {
+		hash = (hash ^ (uint8_t)*string) * 16777619u;
+	}
+
+	return hash;
+}
+
+static uint32_t hash_pointer(const void *source)
+{
+	uint64_t value = (uint64_t)(uintptr_t)source;
+
+	value ^= value >> 33;
+	value *= 0xFF51AFD7ED558CCDull;
+	value ^= value >> 33;
+
+	return (uint32_t)value;
+}
+
+static bool grow_strings(el_image_builder *builder)
+{
+	uint32_t capacity = (builder->stringCapacity == 0) ? 1024 : builder->stringCapacity * 2;
+	uint32_t *strings = (uint32_t *)calloc(capacity, sizeof(uint32_t));
+	if (strings == NULL) {
+		builder->failed = true;
+		return false;
+	}
+
+	for (uint32_t i = 0; i < builder->stringCapacity; i++) {
+		uint32_t offset = builder->strings[i];
+		if (offset == 0)
+			continue;
+
+		uint32_t slot = hash_string(&builder->data[offset]) & (capacity - 1);
+		while (strings[slot] != 0)
+			slot = (slot + 1) & (capacity - 1);
+		strings[slot] = offset;
+	}
+
+	free(builder->strings);
+	builder->strings = strings;
+	builder->stringCapacity = capacity;
+
+	return true;
+}
+
+// NULLは0になる
+uint32_t el_image_add_string(el_image_builder *builder, const char *string)
+{
+	if (string == NULL)
+		return 0;
+
+	if ((builder->stringCount + 1) * 2 > builder->stringCapacity) {
+		if (!grow_strings(builder))
+			return 0;
+	}
+
+	uint32_t slot = hash_string(string) & (builder->stringCapacity - 1);
+	for (uint32_t offset; (offset = builder->strings[slot]) != 0; slot = (slot + 1) & (builder->stringCapacity - 1)) {
+		if (strcmp(&builder->data[offset], string) == 0)
+			return offset;
+	}
+
+	size_t length = strlen(string);
+	uint32_t offset = (length < UINT32_MAX) ? el_image_alloc(builder, (uint32_t)length + 1) : 0;
+	if (offset == 0) {
+		builder->failed = true;
+		return 0;
+	}
+
+	memcpy(&builder->data[offset], string, length + 1);
+	builder->strings[slot] = offset;
+	builder->stringCount++;
+
+	return offset;
+}
+
+// 書き込み済みの配列を元のアドレスで探す。元の配列はイメージを作り終えるまで解放しないこと
+uint32_t el_image_find_shared(el_image_builder *builder, const void *source)
+{
+	if ((source == NULL) || (builder->sharedCount == 0))
+		return 0;
+
+	uint32_t slot = hash_pointer(source) & (builder->sharedCapacity - 1);
+	for (; builder->shared[slot].source != NULL; slot = (slot + 1) & (builder->sharedCapacity - 1)) {
+		if (builder->shared[slot].source == source)
+			return builder->shared[slot].offset;
+	}
+
+	return 0;
+}
+
+void el_image_add_shared(el_image_builder *builder, const void *source, uint32_t offset)
+{
+	if ((source == NULL) || (offset == 0))
+		return;
+
+	if ((builder->sharedCount + 1) * 2 > builder->sharedCapacity) {
+		uint32_t capacity = (builder->sharedCapacity == 0) ? 1024 : builder->sharedCapacity * 2;
+		el_image_shared *shared = (el_image_shared *)calloc(capacity, sizeof(el_image_shared));
+		if (shared == NULL) {
+			builder->failed = true;
+			return;
+		}
+
+		for (uint32_t i = 0; i < builder->sharedCapacity; i++) {
+			if (builder->shared[i].source == NULL)
+				continue;
+
+			uint32_t slot = hash_pointer(builder->shared[i].source) & (capacity - 1);
+			while (shared[slot].source != NULL)
+				slot = (slot + 1) & (capacity - 1);
+			shared[slot] = builder->shared[i];
+		}
+
+		free(builder->shared);
+		builder->shared = shared;
+		builder->sharedCapacity = capacity;
+	}
+
+	uint32_t slot = hash_pointer(source) & (builder->sharedCapacity - 1);
+	while (builder->shared[slot].source != NULL) {
+		if (builder->shared[slot].source == source)
+			return;
+		slot = (slot + 1) & (builder->sharedCapacity - 1);
+	}
+
+	builder->shared[slot].source = source;
+	builder->shared[slot].offset = offset;
+	builder->sharedCount++;
+}
+
+// 機器の表は保存するときにクラスコード順に並べる
+void el_image_add_device(el_image_builder *builder, const el_image_device *device)
+{
+	if (builder->deviceCount == builder->deviceCapacity) {
+		uint32_t capacity = (builder->deviceCapacity == 0) ? 128 : builder->deviceCapacity * 2;
+		el_image_device *devices = (el_image_device *)realloc(builder->devices, capacity * sizeof(el_image_device));
+		if (devices == NULL) {
+			builder->failed = true;
+			return;
+		}
+		builder->devices = devices;
+		builder->deviceCapacity = capacity;
+	}
+
+	builder->devices[builder->deviceCount++] = *device;
+}
+
+static int compare_device(const void *a, const void *b)
+{
+	const el_image_device *device1 = (const el_image_device *)a, *device2 = (const el_image_device *)b;
+
+	if (device1->classCode != device2->classCode)
+		return (device1->classCode < device2->classCode) ? -1 : 1;
+
+	// 同じクラスコードは付録の順（reservedに追加した順を入れてある）
+	return (device1->reserved < device2->reserved) ? -1 : (device1->reserved > device2->reserved) ? 1 : 0;
+}
+
+// 同じクラスコードの機器のプロパティをEPCの表にする。superClassの表を元にし、付録で後にあるものを優先する
+// 前にあったものはalternativeにつなぎ、リリースを指定したときにたどる
+static uint32_t build_property_table(el_image_builder *builder, const el_image_device *device, const el_image_device *end,
+	uint32_t superClass)
+{
+	uint32_t table = el_image_alloc(builder, 256 * sizeof(uint32_t));
+	uint32_t *epcs = (uint32_t *)el_image_at(builder, table);
+	if (epcs == NULL)
+		return 0;
+
+	if (superClass != 0)
+		memcpy(epcs, el_image_at(builder, superClass), 256 * sizeof(uint32_t));
+
+	for (uint16_t classCode = device->classCode; (device < end) && (device->classCode == classCode); device++) {
+		el_image_property *property = (el_image_property *)el_image_at(builder, device->properties);
+		for (uint32_t i = 0; (property != NULL) && (i < device->propertyCount); i++, property++) {
+			property->alternative = epcs[property->epc];
+			epcs[property->epc] = device->properties + i * sizeof(el_image_property);
+		}
+	}
+
+	return table;
+}
+
+// クラスコードの上位（クラスグループコード）と下位で引く2段の表。使うクラスグループの分だけ確保する
+static void build_property_index(el_image_builder *builder, const el_image_device *devices, uint32_t deviceCount)
+{
+	const el_image_device *end = devices + deviceCount;
+	uint32_t superClass = 0;
+
+	// スーパークラスはクラスコード順で先頭にある
+	if ((devices < end) && (devices->classCode == 0x0000))
+		superClass = build_property_table(builder, devices, end, 0);
+
+	uint32_t groups = el_image_alloc(builder, 256 * sizeof(uint32_t));
+
+	for (const el_image_device *device = devices; device < end; ) {
+		const el_image_device *next = device;
+		while ((next < end) && (next->classCode == device->classCode))
+			next++;
+
+		int group = device->classCode >> 8;
+		uint32_t *groupTable = (uint32_t *)el_image_at(builder, groups);
+		if ((groupTable != NULL) && (groupTable[group] == 0)) {
+			uint32_t classes = el_image_alloc(builder, 256 * sizeof(uint32_t));
+			groupTable = (uint32_t *)el_image_at(builder, groups);
+			if (groupTable != NULL)
+				groupTable[group] = classes;
+		}
+
+		uint32_t table = (device->classCode == 0x0000) ? superClass
+			: build_property_table(builder, device, next, el_image_has_super_class(device->classCode) ? superClass : 0);
+		groupTable = (uint32_t *)el_image_at(builder, groups);
+		uint32_t *classTable = (groupTable != NULL) ? (uint32_t *)el_image_at(builder, groupTable[group]) : NULL;
+		if (classTable != NULL)
+			classTable[device->classCode & 0xFF] = table;
+
+		device = next;
+	}
+
+	el_image_header *header = (el_image_header *)el_image_at(builder, 0);
+	if (header != NULL) {
+		header->propertyIndex = groups;
+		header->superClassProperties = superClass;
+	}
+}
+
+bool el_image_save(el_image_builder *builder, const char *filename)
+{
+	if (builder->deviceCount > UINT16_MAX)
+		builder->failed = true;
+
+	uint32_t devices = el_image_alloc(builder, builder->deviceCount * sizeof(el_image_device));
+	if ((devices == 0) && (builder->deviceCount != 0))
+		builder->failed = true;
+	if (builder->failed)
+		return false;
+
+	for (uint32_t i = 0; i < builder->deviceCount; i++) {
+		builder->devices[i].reserved = (uint16_t)i;
+	}
+	qsort(builder->devices, builder->deviceCount, sizeof(el_image_device), compare_device);
+	for (uint32_t i = 0; i < builder->deviceCount; i++) {
+		builder->devices[i].reserved = 0;
+	}
+	if (builder->deviceCount != 0)
+		memcpy(&builder->data[devices], builder->devices, builder->deviceCount * sizeof(el_image_device));
+
+	build_property_index(builder, builder->devices, builder->deviceCount);
+	if (builder->failed)
+		return false;
+
+	el_image_header *header = (el_image_header *)builder->data;
+	header->size = builder->size;
+	header->deviceCount = builder->deviceCount;
+	header->devices = devices;
+
+	HANDLE file = CreateFileA(filename, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	DWORD written = 0;
+	BOOL result = WriteFile(file, builder->data, builder->size, &written, NULL);
+	CloseHandle(file);
+
+	return result && (written == builder->size);
+}
@@ -0,0 +1,204 @@
+﻿#pragma once
+
+#include <stdint.h>
+
+// 付録の機器定義を変換したバイナリイメージ
+// ファイルをマップしてそのまま参照できるよう、参照はすべてイメージ先頭からのオフセット（0はなし）で持つ
+// 数値はリトルエンディアン。構造体は8バイト境界に置く
+#define EL_IMAGE_MAGIC "ELPNPIMG"
+#define EL_IMAGE_VERSION 6
+
+typedef enum access_rule {
+	ACCESS_RULE_NONE,
+	ACCESS_RULE_REQUIRED,
+	ACCESS_RULE_BY_CASE,
+	ACCESS_RULE_OPTIONAL,
+	ACCESS_RULE_NA,
+} access_rule;
+
+typedef enum data_type {
+	DATA_TYPE_NONE,
+	DATA_TYPE_STATE,
+	DATA_TYPE_OBJECT,
+	DATA_TYPE_DATE_TIME,
+	DATA_TYPE_TIME,
+	DATA_TYPE_RAW,
+	DATA_TYPE_ARRAY,
+	DATA_TYPE_BITMAP,
+	DATA_TYPE_LEVEL,
+	DATA_TYPE_NUMBER,
+	DATA_TYPE_NUMERIC_VALUE,
+	DATA_TYPE_ONE_OF,
+} data_type;
+
+typedef enum number_format {
+	NUMBER_FORMAT_NONE,
+	NUMBER_FORMAT_INT8,
+	NUMBER_FORMAT_INT16,
+	NUMBER_FORMAT_INT32,
+	NUMBER_FORMAT_UINT8,
+	NUMBER_FORMAT_UINT16,
+	NUMBER_FORMAT_UINT32,
+} number_format;
+
+typedef struct el_image_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t size;
+	uint32_t release;			// 付録のリリース
+	uint32_t appendixVersion;	// 付録の版
+	uint32_t definitionCount;
+	uint32_t definitions;		// el_image_definition[]（名前順）
+	uint32_t deviceCount;
+	uint32_t devices;			// el_image_device[]（クラスコード順）
+	uint32_t propertyIndex;		// uint32_t[256]（クラスグループコード）→ uint32_t[256]（クラスコード）→ uint32_t[256]（EPC）→ el_image_property
+	uint32_t superClassProperties;	// uint32_t[256]（EPC）。索引にない機器オブジェクトのクラスコードに使う
+} el_image_header;
+
+// data_infoと同じ内容。$refの定義は展開済み
+typedef struct el_image_data {
+	uint8_t type;				// data_type
+	uint8_t numFormat;			// number_format
+	uint16_t reserved;
+	int32_t size;
+	uint32_t name;
+	uint32_t ref;
+	uint32_t unit;
+	uint32_t base;
+	int32_t itemSize, minItems, maxItems, minimum, maximum;
+	uint32_t edtCount;
+	uint32_t edts;				// el_image_edt[]
+	uint32_t numberEnumCount;
+	uint32_t numberEnum;		// int64_t[]
+	uint32_t coefficientEpcCount;
+	uint32_t coefficientEpcs;	// uint32_t[]（EPC）
+	uint32_t dataInfoCount;
+	uint32_t dataInfos;			// el_image_data[]
+	uint32_t bitmapInfoCount;
+	uint32_t bitmapInfos;		// el_image_bitmap[]
+	uint32_t stateTable;		// uint8_t[256]。1バイトのstate、numericValueでEDTからedtsの番号を引く（なければEL_IMAGE_NO_STATE）
+	double multipleOf, minSize, maxSize;
+} el_image_data;
+
+#define EL_IMAGE_NO_STATE 0xFF
+
+typedef struct el_image_edt {
+	int32_t edt;
+	uint32_t stateJa;
+	uint32_t stateEn;
+	uint8_t readOnly;
+	uint8_t reserved[3];
+	double numericValue;
+} el_image_edt;
+
+typedef struct el_image_bitmap {
+	uint32_t name;
+	uint32_t descriptionsJa;
+	uint32_t descriptionsEn;
+	int32_t index;
+	uint32_t bitMask;
+	uint8_t mask;				// bitMaskを数値にしたもの。0なら変換できない
+	uint8_t shift;				// maskの最下位ビットの位置
+	uint16_t reserved;
+	el_image_data value;
+} el_image_bitmap;
+
+typedef struct el_image_definition {
+	uint32_t name;
+	uint32_t data;				// el_image_data
+} el_image_definition;
+
+// プロパティの"oneOf"は同じEPCのプロパティを続けて並べる
+typedef struct el_image_property {
+	uint8_t epc;
+	uint8_t getAccess;			// access_rule
+	uint8_t setAccess;
+	uint8_t infAccess;
+	uint32_t validFrom;
+	uint32_t validTo;
+	uint32_t propertyNameJa;
+	uint32_t propertyNameEn;
+	uint32_t data;				// el_image_data
+	uint32_t validReleases;		// 有効なリリースのビット（el_image_release_mask）。機器の範囲と重ねてある
+	uint32_t alternative;		// 同じクラスコード、EPCで付録の前にあるプロパティ（なければスーパークラスのもの）
+	uint32_t flags;				// EL_IMAGE_PROPERTY_*
+	uint32_t reserved;
+} el_image_property;
+
+#define EL_IMAGE_PROPERTY_COEFFICIENT 0x01	// 同じ機器のほかのプロパティの係数（coefficient）になる
+
+// 機器の"oneOf"は同じクラスコードの機器を付録の順に並べる
+typedef struct el_image_device {
+	uint16_t classCode;
+	uint16_t reserved;
+	uint32_t validFrom;
+	uint32_t validTo;
+	uint32_t classNameJa;
+	uint32_t classNameEn;
+	uint32_t propertyCount;
+	uint32_t properties;		// el_image_property[]
+	uint32_t validReleases;
+} el_image_device;
+
+// イメージを読み込む。ヘッダーと表の範囲だけを確かめ、内容は変換したときのまま信用する
+const el_image_header *el_image_open(const char *filename);
+void el_image_close(const el_image_header *image);
+const el_image_definition *el_image_find_definition(const el_image_header *image, const char *name);
+const el_image_device *el_image_find_device(const el_image_header *image, int classCode);
+const el_image_property *el_image_find_property(const el_image_header *image, int classCode, int epc, int release);
+
+// リリースは'A'〜'Z'の文字で表し、0は最新（索引にある、付録で最後のもの）
+#define EL_RELEASE_LATEST 0
+
+// validReleaseの範囲をビット（'A'がビット0）にする。fromがなければ最初から、toが"latest"かなければ以降すべて
+uint32_t el_image_release_mask(const char *from, const char *to);
+
+// スーパークラス（0x0000）は機器オブジェクトのもの。プロファイル（クラスグループ0x0E）は継承しない
+#define EL_IMAGE_PROFILE_GROUP 0x0E
+
+inline bool el_image_has_super_class(int classCode)
+{
+	return (classCode >> 8) != EL_IMAGE_PROFILE_GROUP;
+}
+
+inline uint32_t el_image_release_bit(int release)
+{
+	return ((release >= 'A') && (release <= 'Z')) ? (1u << (release - 'A')) : 0;
+}
+
+inline const void *el_image_get(const el_image_header *image, uint32_t offset)
+{
+	return (offset == 0) ? NULL : (const char *)image + offset;
+}
+
+inline const char *el_image_get_string(const el_image_header *image, uint32_t offset)
+{
+	return (const char *)el_image_get(image, offset);
+}
+
+// イメージを作る。文字列は重複を除き、定義と共有する配列は一度だけ書き込む
+typedef struct el_image_builder {
+	char *data;
+	uint32_t size;
+	uint32_t capacity;
+	uint32_t *strings;			// 文字列のハッシュ表（オフセット）
+	uint32_t stringCount;
+	uint32_t stringCapacity;
+	struct el_image_shared *shared;	// 書き込んだ配列のハッシュ表（元のアドレス）
+	uint32_t sharedCount;
+	uint32_t sharedCapacity;
+	el_image_device *devices;
+	uint32_t deviceCount;
+	uint32_t deviceCapacity;
+	bool failed;
+} el_image_builder;
+
+bool el_image_builder_init(el_image_builder *builder);
+void el_image_builder_free(el_image_builder *builder);
+uint32_t el_image_alloc(el_image_builder *builder, uint32_t size);
+void *el_image_at(el_image_builder *builder, uint32_t offset);
+uint32_t el_image_add_string(el_image_builder *builder, const char *string);
+uint32_t el_image_find_shared(el_image_builder *builder, const void *source);
+void el_image_add_shared(el_image_builder *builder, const void *source, uint32_t offset);
+void el_image_add_device(el_image_builder *builder, const el_image_device *device);
+bool el_image_save(el_image_builder *builder, const char *filename);
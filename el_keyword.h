@@ -0,0 +1,144 @@
+﻿#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+// 付録のJSONのメンバー名と、type、format、accessRuleなどの値
+// 完全ハッシュの表をコンパイル時に作り、el_get_keywordで1回のハッシュと1回の比較で分類する
+typedef enum el_keyword {
+	EL_KEYWORD_NONE,
+	EL_KEYWORD_REQUIRED,
+	EL_KEYWORD_REQUIRED_C,
+	EL_KEYWORD_OPTIONAL,
+	EL_KEYWORD_NOT_APPLICABLE,
+	EL_KEYWORD_TYPE,
+	EL_KEYWORD_STATE,
+	EL_KEYWORD_OBJECT,
+	EL_KEYWORD_DATE_TIME,
+	EL_KEYWORD_TIME,
+	EL_KEYWORD_RAW,
+	EL_KEYWORD_ARRAY,
+	EL_KEYWORD_BITMAP,
+	EL_KEYWORD_LEVEL,
+	EL_KEYWORD_NUMBER,
+	EL_KEYWORD_NUMERIC_VALUE,
+	EL_KEYWORD_SIZE,
+	EL_KEYWORD_ENUM,
+	EL_KEYWORD_EDT,
+	EL_KEYWORD_READ_ONLY,
+	EL_KEYWORD_PROPERTIES,
+	EL_KEYWORD_NAME,
+	EL_KEYWORD_ELEMENT,
+	EL_KEYWORD_UNIT,
+	EL_KEYWORD_MULTIPLE_OF,
+	EL_KEYWORD_MIN_SIZE,
+	EL_KEYWORD_MAX_SIZE,
+	EL_KEYWORD_ITEM_SIZE,
+	EL_KEYWORD_MIN_ITEMS,
+	EL_KEYWORD_MAX_ITEMS,
+	EL_KEYWORD_BASE,
+	EL_KEYWORD_MINIMUM,
+	EL_KEYWORD_MAXIMUM,
+	EL_KEYWORD_COEFFICIENT,
+	EL_KEYWORD_ITEMS,
+	EL_KEYWORD_BITMAPS,
+	EL_KEYWORD_DESCRIPTIONS,
+	EL_KEYWORD_POSITION,
+	EL_KEYWORD_VALUE,
+	EL_KEYWORD_ONE_OF,
+	EL_KEYWORD_FORMAT,
+	EL_KEYWORD_INT8,
+	EL_KEYWORD_INT16,
+	EL_KEYWORD_INT32,
+	EL_KEYWORD_UINT8,
+	EL_KEYWORD_UINT16,
+	EL_KEYWORD_UINT32,
+	EL_KEYWORD_REF,
+	EL_KEYWORD_VALID_RELEASE,
+	EL_KEYWORD_PROPERTY_NAME,
+	EL_KEYWORD_ACCESS_RULE,
+	EL_KEYWORD_GET,
+	EL_KEYWORD_SET,
+	EL_KEYWORD_INF,
+	EL_KEYWORD_DATA,
+	EL_KEYWORD_ATOMIC,
+	EL_KEYWORD_NOTE,
+	EL_KEYWORD_CLASS_NAME,
+	EL_KEYWORD_EL_PROPERTIES,
+	EL_KEYWORD_FIRST_RELEASE,
+	EL_KEYWORD_META_DATA,
+	EL_KEYWORD_DEFINITIONS,
+	EL_KEYWORD_DEVICES,
+	EL_KEYWORD_COUNT,
+} el_keyword;
+
+// el_keywordの順
+constexpr const char *el_keyword_names[] = {
+	NULL,
+	"required", "required_c", "optional", "notApplicable", "type", "state", "object", "date-time",
+	"time", "raw", "array", "bitmap", "level", "number", "numericValue", "size", "enum", "edt",
+	"readOnly", "properties", "name", "element", "unit", "multipleOf", "minSize", "maxSize",
+	"itemSize", "minItems", "maxItems", "base", "minimum", "maximum", "coefficient", "items",
+	"bitmaps", "descriptions", "position", "value", "oneOf", "format", "int8", "int16", "int32",
+	"uint8", "uint16", "uint32", "$ref", "validRelease", "propertyName", "accessRule", "get", "set",
+	"inf", "data", "atomic", "note", "className", "elProperties", "firstRelease", "metaData",
+	"definitions", "devices"
+};
+
+static_assert(sizeof(el_keyword_names) / sizeof(el_keyword_names[0]) == EL_KEYWORD_COUNT, "el_keyword_names");
+
+#define EL_KEYWORD_TABLE_SIZE 1024
+
+constexpr uint32_t el_keyword_hash(const char *name, uint32_t seed)
+{
+	uint32_t hash = 2166136261u ^ seed;
+	for (; *name != '\0'; name++) {
+		hash = (hash ^ (uint8_t)*name) * 16777619u;
+	}
+	return hash;
+}
+
+typedef struct el_keyword_table {
+	uint32_t seed;
+	uint8_t slots[EL_KEYWORD_TABLE_SIZE];	// el_keyword。EL_KEYWORD_NONEは空き
+} el_keyword_table;
+
+// 名前がすべて別の場所に入るシードを探す
+constexpr bool el_keyword_is_perfect(uint32_t seed)
+{
+	bool used[EL_KEYWORD_TABLE_SIZE] = {};
+	for (int i = 1; i < EL_KEYWORD_COUNT; i++) {
+		uint32_t slot = el_keyword_hash(el_keyword_names[i], seed) & (EL_KEYWORD_TABLE_SIZE - 1);
+		if (used[slot])
+			return false;
+		used[slot] = true;
+	}
+	return true;
+}
+
+constexpr el_keyword_table el_make_keyword_table()
+{
+	el_keyword_table table = {};
+	while (!el_keyword_is_perfect(table.seed))
+		table.seed++;
+
+	for (int i = 1; i < EL_KEYWORD_COUNT; i++) {
+		table.slots[el_keyword_hash(el_keyword_names[i], table.seed) & (EL_KEYWORD_TABLE_SIZE - 1)] = (uint8_t)i;
+	}
+	return table;
+}
+
+constexpr el_keyword_table el_keywords = el_make_keyword_table();
+
+// 表にない名前はEL_KEYWORD_NONE
+inline el_keyword el_get_keyword(const char *name)
+{
+	if (name == NULL)
+		return EL_KEYWORD_NONE;
+
+	int keyword = el_keywords.slots[el_keyword_hash(name, el_keywords.seed) & (EL_KEYWORD_TABLE_SIZE - 1)];
+	if ((keyword == EL_KEYWORD_NONE) || (strcmp(name, el_keyword_names[keyword]) != 0))
+		return EL_KEYWORD_NONE;
+
+	return (el_keyword)keyword;
+}
@@ -1,7 +1,13 @@
 ﻿#include <iostream>
 #include <stdint.h>
+#include <limits.h>
 #include <windows.h>
 #include "parson.h"
+#include "el_image.h"
+#include "el_edt.h"
+#include "el_frame.h"
+#include "el_keyword.h"
+#include "el_access.h"
 
 #if defined(_DEBUG)
 #define new DEBUG_NEW
@@ -10,46 +16,72 @@ static char THIS_FILE[] = __FILE__;
 #endif
 
 typedef struct iot_pnp {
+	JSON_Arena *el_arena;
 	JSON_Value *el_definitions_value;
 	JSON_Object *el_definitions_object;
 	JSON_Value *dt_root_value;
 	JSON_Array *dt_root_array;
-	JSON_Value *dt_contents_value;
-	JSON_Array *dt_contents_array;
+	int definitionInfoCount;
+	struct definition_info *definitionInfos;
+	// 指定されたときはモデルをイメージにも書き込む（変換は読み込みと同じスレッドで行う）
+	el_image_builder *image;
+	// 指定されたときはそのリリース（'A'〜）で有効な機器、プロパティだけを変換する
+	int release;
+	// 指定されたときはEnum、Objectなどのスキーマをインターフェースのschemasに一度だけ書き込み、@idで参照する
+	bool sharedSchemas;
+	// 指定されたときは前回の出力を機器の入力のフィンガープリントごとに覚えておき、入力が変わらない機器は変換しない
+	const char *cacheFilename;
+	JSON_Arena *cache_arena;
+	JSON_Array *cache_interfaces;
+	int cacheEntryCount;
+	struct dt_cache_entry *cacheEntries;	// fingerprintの順
+	// 機器ごとの変換タスク（付録の順）と、それを処理するスレッド
+	struct dt_task **tasks;
+	int taskCount;
+	int taskCapacity;
+	int nextTask;
+	bool noMoreTasks;
+	int threadCount;
+	HANDLE *threads;
+	CRITICAL_SECTION taskLock;
+	CONDITION_VARIABLE taskAdded;
 } iot_pnp;
 
-typedef enum access_rule {
-	ACCESS_RULE_NONE,
-	ACCESS_RULE_REQUIRED,
-	ACCESS_RULE_BY_CASE,
-	ACCESS_RULE_OPTIONAL,
-	ACCESS_RULE_NA,
-} access_rule;
-
-typedef enum data_type {
-	DATA_TYPE_NONE,
-	DATA_TYPE_STATE,
-	DATA_TYPE_OBJECT,
-	DATA_TYPE_DATE_TIME,
-	DATA_TYPE_TIME,
-	DATA_TYPE_RAW,
-	DATA_TYPE_ARRAY,
-	DATA_TYPE_BITMAP,
-	DATA_TYPE_LEVEL,
-	DATA_TYPE_NUMBER,
-	DATA_TYPE_NUMERIC_VALUE,
-	DATA_TYPE_ONE_OF,
-} data_type;
-
-typedef enum number_format {
-	NUMBER_FORMAT_NONE,
-	NUMBER_FORMAT_INT8,
-	NUMBER_FORMAT_INT16,
-	NUMBER_FORMAT_INT32,
-	NUMBER_FORMAT_UINT8,
-	NUMBER_FORMAT_UINT16,
-	NUMBER_FORMAT_UINT32,
-} number_format;
+// 機器一台分の変換。他のスレッドと共有しない状態を持つ
+typedef struct dt_task {
+	iot_pnp *iot_pnp;
+	JSON_Arena *el_arena;
+	JSON_Object *device;
+	uint64_t fingerprint;			// キャッシュを使うときの、機器の入力のフィンガープリント
+	JSON_Arena *dt_arena;
+	int dt_interfaceCount;
+	int dt_interfaceCapacity;
+	JSON_Value **dt_interfaces;
+	JSON_Value *dt_contents_value;
+	JSON_Array *dt_contents_array;
+	JSON_Value *dt_schemas_value;
+	JSON_Array *dt_schemas_array;
+	int dt_schemaCount;
+	int dt_schemaCapacity;
+	struct dt_schema *dt_schemas;
+	int dt_schemaSlotCount;
+	int *dt_schemaSlots;			// dt_schemasをハッシュで引く表（番号+1、0は空き）
+	const char *dt_schemaScope;		// スキーマの@idの前に付ける、インターフェースの@id（末尾のバージョンなし）
+	char *schemaText;				// スキーマのハッシュを計算するときの作業領域
+	size_t schemaTextSize;
+	int classCode;
+	int imagePropertyCount;
+	int imagePropertyCapacity;
+	el_image_property *imageProperties;
+	uint32_t coefficientEpcs[256 / 32];	// 機器のプロパティが係数に使うEPC
+} dt_task;
+
+// インターフェースのschemasに書き込んだスキーマ
+typedef struct dt_schema {
+	uint64_t hash;					// シリアライズした内容のFNV-1a
+	const char *id;
+	char *text;						// シリアライズした内容。ハッシュが同じときに比べる
+} dt_schema;
 
 typedef struct edt_info {
 	int edt;
@@ -69,6 +101,7 @@ typedef struct data_info {
 	const char *base;
 	number_format numFormat;
 	void *number_enum;
+	int numberEnumCount;
 	int edtCount;
 	edt_info *edts;
 	int coefficientEpcCount;
@@ -77,6 +110,8 @@ typedef struct data_info {
 	data_info *dataInfos;
 	int bitmapInfoCount;
 	struct bitmap_info *bitmapInfos;
+	// $refで参照した定義（配列は定義と共有）
+	const data_info *definition;
 };
 
 typedef struct bitmap_info {
@@ -85,28 +120,54 @@ typedef struct bitmap_info {
 	const char *descriptionsEn;
 	int index;
 	const char *bitMask;
+	uint8_t mask;			// bitMaskを数値にしたもの
+	uint8_t shift;
 	data_info value;
 } bitmap_info;
 
-typedef enum dt_if_type {
-	DT_IF_TYPE_NONE,
-	DT_IF_TYPE_TELEMETRY,
-	DT_IF_TYPE_PROPERTY,
-	DT_IF_TYPE_COMMAND,
-} dt_if_type;
+// "definitions"の要素を一度だけ変換して共有するためのキャッシュ
+typedef struct definition_info {
+	const char *name;
+	JSON_Object *data;
+	bool compiled;
+	bool compiling;
+	bool fingerprinted;
+	bool fingerprinting;
+	uint64_t fingerprint;		// 定義の内容と、参照している定義のフィンガープリント
+	data_info dataInfo;
+} definition_info;
+
+// 前回の出力の、機器一台分のインターフェース
+typedef struct dt_cache_entry {
+	uint64_t fingerprint;
+	int firstInterface;			// キャッシュの"interfaces"の番号
+	int interfaceCount;
+} dt_cache_entry;
+
+// 付録ファイルを機器ごとに読み込むときの状態
+typedef struct el_reader {
+	iot_pnp *iot_pnp;
+	JSON_Sax_Handler handler;
+	int depth;
+	bool inMetaData;
+	bool inDevices;
+	int classCode;
+} el_reader;
 
 access_rule get_access_rule(const char *rule)
 {
-	if (strcmp(rule, "required") == 0) {
+	el_keyword ruleKeyword = el_get_keyword(rule);
+
+	if (ruleKeyword == EL_KEYWORD_REQUIRED) {
 		return ACCESS_RULE_REQUIRED;
 	}
-	else if (strcmp(rule, "required_c") == 0) {
+	else if (ruleKeyword == EL_KEYWORD_REQUIRED_C) {
 		return ACCESS_RULE_BY_CASE;
 	}
-	else if (strcmp(rule, "optional") == 0) {
+	else if (ruleKeyword == EL_KEYWORD_OPTIONAL) {
 		return ACCESS_RULE_OPTIONAL;
 	}
-	else if (strcmp(rule, "notApplicable") == 0) {
+	else if (ruleKeyword == EL_KEYWORD_NOT_APPLICABLE) {
 		return ACCESS_RULE_NA;
 	}
 	else {
@@ -137,23 +198,303 @@ int set_digital_twin_id(char *temp, const char *id, int len)
 	return i;
 }
 
+// 文字列のハッシュ（FNV-1a）
+uint64_t hash_text(const char *text)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (; *text != '\0'; text++) {
+		hash = (hash ^ (uint8_t)*text) * 1099511628211ull;
+	}
+	return hash;
+}
+
+// ハッシュに64ビットの値を続けて加える
+uint64_t hash_combine(uint64_t hash, uint64_t value)
+{
+	for (int i = 0; i < 8; i++, value >>= 8) {
+		hash = (hash ^ (uint8_t)value) * 1099511628211ull;
+	}
+	return hash;
+}
+
 void free_data_info(data_info *dataInfo)
 {
-	free(dataInfo->edts);
-	free(dataInfo->number_enum);
-	free(dataInfo->coefficientEpcs);
+	const data_info *definition = dataInfo->definition;
+
+	// 定義から引き継いだ配列はキャッシュ側で解放する
+	if ((definition == NULL) || (dataInfo->edts != definition->edts))
+		free(dataInfo->edts);
+	if ((definition == NULL) || (dataInfo->number_enum != definition->number_enum))
+		free(dataInfo->number_enum);
+	if ((definition == NULL) || (dataInfo->coefficientEpcs != definition->coefficientEpcs))
+		free(dataInfo->coefficientEpcs);
+
+	if ((definition == NULL) || (dataInfo->dataInfos != definition->dataInfos)) {
+		data_info *dataInfo2 = dataInfo->dataInfos;
+		for (int i = 0; i < dataInfo->dataInfoCount; i++, dataInfo2++) {
+			free_data_info(dataInfo2);
+		}
+		free(dataInfo->dataInfos);
+	}
 
-	data_info *dataInfo2 = dataInfo->dataInfos;
-	for (int i = 0; i < dataInfo->dataInfoCount; i++, dataInfo2++) {
-		free_data_info(dataInfo2);
+	if ((definition == NULL) || (dataInfo->bitmapInfos != definition->bitmapInfos)) {
+		bitmap_info *bitmapInfo = dataInfo->bitmapInfos;
+		for (int i = 0; i < dataInfo->bitmapInfoCount; i++, bitmapInfo++) {
+			free_data_info(&bitmapInfo->value);
+		}
+		free(dataInfo->bitmapInfos);
 	}
-	free(dataInfo->dataInfos);
+}
 
-	bitmap_info *bitmapInfo = dataInfo->bitmapInfos;
-	for (int i = 0; i < dataInfo->bitmapInfoCount; i++, bitmapInfo++) {
-		free_data_info(&bitmapInfo->value);
+void parse_data(iot_pnp *iot_pnp, JSON_Object *data, data_info *dataInfo);
+
+int compare_definition_info(const void *a, const void *b)
+{
+	return strcmp(((const definition_info *)a)->name, ((const definition_info *)b)->name);
+}
+
+void init_definition_infos(iot_pnp *iot_pnp)
+{
+	int count = json_object_get_count(iot_pnp->el_definitions_object);
+	definition_info *definitionInfo = (definition_info *)calloc(count, sizeof(definition_info));
+	if (definitionInfo == NULL) {
+		DebugBreak();
+		return;
+	}
+
+	iot_pnp->definitionInfoCount = count;
+	iot_pnp->definitionInfos = definitionInfo;
+
+	for (int i = 0; i < count; i++, definitionInfo++) {
+		definitionInfo->name = json_object_get_name(iot_pnp->el_definitions_object, i);
+		definitionInfo->data = json_value_get_object(json_object_get_value_at(iot_pnp->el_definitions_object, i));
+	}
+
+	qsort(iot_pnp->definitionInfos, count, sizeof(definition_info), compare_definition_info);
+}
+
+void free_definition_infos(iot_pnp *iot_pnp)
+{
+	definition_info *definitionInfo = iot_pnp->definitionInfos;
+	for (int i = 0; i < iot_pnp->definitionInfoCount; i++, definitionInfo++) {
+		if (definitionInfo->compiled)
+			free_data_info(&definitionInfo->dataInfo);
+	}
+	free(iot_pnp->definitionInfos);
+
+	iot_pnp->definitionInfoCount = 0;
+	iot_pnp->definitionInfos = NULL;
+}
+
+const data_info *get_definition(iot_pnp *iot_pnp, const char *name)
+{
+	definition_info key;
+	key.name = name;
+
+	definition_info *definitionInfo = (definition_info *)bsearch(&key, iot_pnp->definitionInfos,
+		iot_pnp->definitionInfoCount, sizeof(definition_info), compare_definition_info);
+	if ((definitionInfo == NULL) || (definitionInfo->data == NULL))
+		return NULL;
+
+	if (!definitionInfo->compiled) {
+		// 循環参照
+		if (definitionInfo->compiling)
+			return NULL;
+
+		definitionInfo->compiling = true;
+		parse_data(iot_pnp, definitionInfo->data, &definitionInfo->dataInfo);
+		definitionInfo->compiling = false;
+		definitionInfo->compiled = true;
+	}
+
+	return &definitionInfo->dataInfo;
+}
+
+// 並列に変換する前に全ての定義を変換しておく（以降は読み取りのみ）
+void compile_definition_infos(iot_pnp *iot_pnp)
+{
+	definition_info *definitionInfo = iot_pnp->definitionInfos;
+	for (int i = 0; i < iot_pnp->definitionInfoCount; i++, definitionInfo++) {
+		get_definition(iot_pnp, definitionInfo->name);
+	}
+}
+
+uint64_t fingerprint_definition(iot_pnp *iot_pnp, const char *name);
+
+// 値の内容のハッシュ。"$ref"で参照している定義は、その定義のフィンガープリントも加える
+uint64_t fingerprint_value(iot_pnp *iot_pnp, const JSON_Value *value, uint64_t hash)
+{
+	JSON_Value_Type type = json_value_get_type(value);
+	hash = hash_combine(hash, type);
+
+	switch (type) {
+	case JSONObject: {
+		JSON_Object *object = json_value_get_object(value);
+		for (int i = 0; i < (int)json_object_get_count(object); i++) {
+			const char *name = json_object_get_name(object, i);
+			JSON_Value *member = json_object_get_value_at(object, i);
+			hash = hash_combine(hash, hash_text(name));
+			hash = fingerprint_value(iot_pnp, member, hash);
+
+			const char *ref = (el_get_keyword(name) == EL_KEYWORD_REF) ? json_value_get_string(member) : NULL;
+			if ((ref != NULL) && (strncmp(ref, "#/definitions/", 14) == 0)) {
+				hash = hash_combine(hash, fingerprint_definition(iot_pnp, &ref[14]));
+			}
+		}
+		break;
+	}
+	case JSONArray: {
+		JSON_Array *array = json_value_get_array(value);
+		for (int i = 0; i < (int)json_array_get_count(array); i++) {
+			hash = fingerprint_value(iot_pnp, json_array_get_value(array, i), hash);
+		}
+		break;
+	}
+	case JSONString:
+		hash = hash_combine(hash, hash_text(json_value_get_string(value)));
+		break;
+	case JSONNumber: {
+		double number = json_value_get_number(value);
+		uint64_t bits;
+		memcpy(&bits, &number, sizeof(bits));
+		hash = hash_combine(hash, bits);
+		break;
 	}
-	free(dataInfo->bitmapInfos);
+	case JSONBoolean:
+		hash = hash_combine(hash, json_value_get_boolean(value));
+		break;
+	}
+
+	return hash;
+}
+
+uint64_t fingerprint_definition(iot_pnp *iot_pnp, const char *name)
+{
+	definition_info key;
+	key.name = name;
+
+	definition_info *definitionInfo = (definition_info *)bsearch(&key, iot_pnp->definitionInfos,
+		iot_pnp->definitionInfoCount, sizeof(definition_info), compare_definition_info);
+	if (definitionInfo == NULL)
+		return 0;
+
+	if (!definitionInfo->fingerprinted) {
+		// 循環参照は名前だけ
+		if (definitionInfo->fingerprinting)
+			return hash_text(name);
+
+		definitionInfo->fingerprinting = true;
+		definitionInfo->fingerprint = fingerprint_value(iot_pnp,
+			json_object_get_wrapping_value(definitionInfo->data), hash_text(name));
+		definitionInfo->fingerprinting = false;
+		definitionInfo->fingerprinted = true;
+	}
+
+	return definitionInfo->fingerprint;
+}
+
+// 並列に変換する前に全ての定義のフィンガープリントを計算しておく（以降は読み取りのみ）
+void fingerprint_definition_infos(iot_pnp *iot_pnp)
+{
+	definition_info *definitionInfo = iot_pnp->definitionInfos;
+	for (int i = 0; i < iot_pnp->definitionInfoCount; i++, definitionInfo++) {
+		fingerprint_definition(iot_pnp, definitionInfo->name);
+	}
+}
+
+// 定義から引き継いだ配列ではなく、自分で確保した配列か
+bool owns_array(const data_info *dataInfo, const void *array)
+{
+	const data_info *definition = dataInfo->definition;
+
+	if (array == NULL)
+		return false;
+	if (definition == NULL)
+		return true;
+
+	return (array != definition->edts) && (array != definition->number_enum) && (array != definition->coefficientEpcs)
+		&& (array != definition->dataInfos) && (array != definition->bitmapInfos);
+}
+
+// 定義の内容を引き継ぐ（配列は複製せずに共有する）
+void inherit_data_info(data_info *dataInfo, const data_info *definition)
+{
+	if (dataInfo->type != DATA_TYPE_NONE)
+		DebugBreak();
+
+	dataInfo->definition = definition;
+
+	if (definition->type != DATA_TYPE_NONE)
+		dataInfo->type = definition->type;
+	if (definition->size != 0)
+		dataInfo->size = definition->size;
+	if (definition->name != NULL)
+		dataInfo->name = definition->name;
+	if (definition->unit != NULL)
+		dataInfo->unit = definition->unit;
+	if (definition->multipleOf != 0)
+		dataInfo->multipleOf = definition->multipleOf;
+	if (definition->minSize != 0)
+		dataInfo->minSize = definition->minSize;
+	if (definition->maxSize != 0)
+		dataInfo->maxSize = definition->maxSize;
+	if (definition->itemSize != 0)
+		dataInfo->itemSize = definition->itemSize;
+	if (definition->minItems != 0)
+		dataInfo->minItems = definition->minItems;
+	if (definition->maxItems != 0)
+		dataInfo->maxItems = definition->maxItems;
+	if (definition->minimum != 0)
+		dataInfo->minimum = definition->minimum;
+	if (definition->maximum != 0)
+		dataInfo->maximum = definition->maximum;
+	if (definition->base != NULL)
+		dataInfo->base = definition->base;
+	if (definition->numFormat != NUMBER_FORMAT_NONE)
+		dataInfo->numFormat = definition->numFormat;
+	if (definition->edts != NULL) {
+		dataInfo->edtCount = definition->edtCount;
+		dataInfo->edts = definition->edts;
+	}
+	if (definition->number_enum != NULL) {
+		dataInfo->numberEnumCount = definition->numberEnumCount;
+		dataInfo->number_enum = definition->number_enum;
+	}
+	if (definition->coefficientEpcs != NULL) {
+		dataInfo->coefficientEpcCount = definition->coefficientEpcCount;
+		dataInfo->coefficientEpcs = definition->coefficientEpcs;
+	}
+	if (definition->dataInfos != NULL) {
+		dataInfo->dataInfoCount = definition->dataInfoCount;
+		dataInfo->dataInfos = definition->dataInfos;
+	}
+	if (definition->bitmapInfos != NULL) {
+		dataInfo->bitmapInfoCount = definition->bitmapInfoCount;
+		dataInfo->bitmapInfos = definition->bitmapInfos;
+	}
+}
+
+// "0b"で始まるビットマスクを、1バイトのマスクと最下位ビットの位置にする
+bool compile_bit_mask(bitmap_info *bitmapInfo)
+{
+	const char *bitMask = bitmapInfo->bitMask;
+	char *end;
+
+	if ((bitMask == NULL) || (_strnicmp(bitMask, "0b", 2) != 0))
+		return false;
+
+	unsigned long mask = strtoul(&bitMask[2], &end, 2);
+	if ((*end != '\0') || (mask == 0) || (mask > 0xFF))
+		return false;
+
+	int shift = 0;
+	while ((mask & (1ul << shift)) == 0)
+		shift++;
+
+	bitmapInfo->mask = (uint8_t)mask;
+	bitmapInfo->shift = (uint8_t)shift;
+
+	return true;
 }
 
 void parse_data(iot_pnp *iot_pnp, JSON_Object *data, data_info *dataInfo)
@@ -161,10 +502,29 @@ void parse_data(iot_pnp *iot_pnp, JSON_Object *data, data_info *dataInfo)
 	if (dataInfo->type != DATA_TYPE_NONE)
 		DebugBreak();
 
+	// $refを先に引き継ぎ、JSONの順序に関係なく兄弟のメンバーで上書きする
+	// 兄弟のメンバーが確保した配列は、共有している定義の配列と置き換わる
+	if (json_object_has_value(data, "$ref")) {
+		const char *ref = json_object_get_string(data, "$ref");
+		dataInfo->ref = ref;
+
+		if ((ref == NULL) || (strncmp(ref, "#/definitions/", 14) != 0)) {
+			DebugBreak();
+		}
+		else {
+			const data_info *definition = get_definition(iot_pnp, &ref[14]);
+			if (definition == NULL)
+				DebugBreak();
+			else
+				inherit_data_info(dataInfo, definition);
+		}
+	}
+
 	for (int j = 0; j < json_object_get_count(data); j++) {
 		const char *member = json_object_get_name(data, j);
+		el_keyword memberKeyword = el_get_keyword(member);
 
-		if (strcmp(member, "type") == 0) {
+		if (memberKeyword == EL_KEYWORD_TYPE) {
 			const char *type_str;
 
 			type_str = json_object_get_string(data, "type");
@@ -173,34 +533,36 @@ void parse_data(iot_pnp *iot_pnp, JSON_Object *data, data_info *dataInfo)
 				continue;
 			}
 
-			if (strcmp(type_str, "state") == 0) {
+			el_keyword typeKeyword = el_get_keyword(type_str);
+
+			if (typeKeyword == EL_KEYWORD_STATE) {
 				dataInfo->type = DATA_TYPE_STATE;
 			}
-			else if (strcmp(type_str, "object") == 0) {
+			else if (typeKeyword == EL_KEYWORD_OBJECT) {
 				dataInfo->type = DATA_TYPE_OBJECT;
 			}
-			else if (strcmp(type_str, "date-time") == 0) {
+			else if (typeKeyword == EL_KEYWORD_DATE_TIME) {
 				dataInfo->type = DATA_TYPE_DATE_TIME;
 			}
-			else if (strcmp(type_str, "time") == 0) {
+			else if (typeKeyword == EL_KEYWORD_TIME) {
 				dataInfo->type = DATA_TYPE_TIME;
 			}
-			else if (strcmp(type_str, "raw") == 0) {
+			else if (typeKeyword == EL_KEYWORD_RAW) {
 				dataInfo->type = DATA_TYPE_RAW;
 			}
-			else if (strcmp(type_str, "array") == 0) {
+			else if (typeKeyword == EL_KEYWORD_ARRAY) {
 				dataInfo->type = DATA_TYPE_ARRAY;
 			}
-			else if (strcmp(type_str, "bitmap") == 0) {
+			else if (typeKeyword == EL_KEYWORD_BITMAP) {
 				dataInfo->type = DATA_TYPE_BITMAP;
 			}
-			else if (strcmp(type_str, "level") == 0) {
+			else if (typeKeyword == EL_KEYWORD_LEVEL) {
 				dataInfo->type = DATA_TYPE_LEVEL;
 			}
-			else if (strcmp(type_str, "number") == 0) {
+			else if (typeKeyword == EL_KEYWORD_NUMBER) {
 				dataInfo->type = DATA_TYPE_NUMBER;
 			}
-			else if (strcmp(type_str, "numericValue") == 0) {
+			else if (typeKeyword == EL_KEYWORD_NUMERIC_VALUE) {
 				dataInfo->type = DATA_TYPE_NUMERIC_VALUE;
 			}
 			else {
@@ -208,7 +570,7 @@ void parse_data(iot_pnp *iot_pnp, JSON_Object *data, data_info *dataInfo)
 				continue;
 			}
 		}
-		else if (strcmp(member, "size") == 0) {
+		else if (memberKeyword == EL_KEYWORD_SIZE) {
 			JSON_Value *size_value;
 
 			size_value = json_object_get_value(data, "size");
@@ -228,7 +590,7 @@ void parse_data(iot_pnp *iot_pnp, JSON_Object *data, data_info *dataInfo)
 				continue;
 			}
 		}
-		else if (strcmp(member, "enum") == 0) {
+		else if (memberKeyword == EL_KEYWORD_ENUM) {
 			JSON_Array *data_enum;
 
 			data_enum = json_object_get_array(data, "enum");
@@ -240,7 +602,7 @@ void parse_data(iot_pnp *iot_pnp, JSON_Object *data, data_info *dataInfo)
 			if ((dataInfo->type == DATA_TYPE_STATE) || (dataInfo->type == DATA_TYPE_NUMERIC_VALUE)) {
 				int enumCount = json_array_get_count(data_enum);
 				edt_info *edt = (edt_info *)malloc(sizeof(edt_info) * enumCount);
-				if (dataInfo->edts != NULL)
+				if (owns_array(dataInfo, dataInfo->edts))
 					DebugBreak();
 				dataInfo->edtCount = enumCount;
 				dataInfo->edts = edt;
@@ -256,9 +618,10 @@ void parse_data(iot_pnp *iot_pnp, JSON_Object *data, data_info *dataInfo)
 
 					for (int l = 0; l < json_object_get_count(edtInfo); l++) {
 						const char *info_member = json_object_get_name(edtInfo, l);
+						el_keyword infoKeyword = el_get_keyword(info_member);
 						const char *edt_str;
 
-						if (strcmp(info_member, "edt") == 0) {
+						if (infoKeyword == EL_KEYWORD_EDT) {
 							JSON_Value *edt_value = json_object_get_value(edtInfo, "edt");
 							if (json_value_get_type(edt_value) == JSONString) {
 								edt_str = json_object_get_string(edtInfo, "edt");
@@ -277,17 +640,17 @@ void parse_data(iot_pnp *iot_pnp, JSON_Object *data, data_info *dataInfo)
 								continue;
 							}
 						}
-						else if (strcmp(info_member, "state") == 0) {
+						else if (infoKeyword == EL_KEYWORD_STATE) {
 							JSON_Object *edt_state;
 
 							edt_state = json_object_get_object(edtInfo, "state");
 							edt->stateJa = json_object_get_string(edt_state, "ja");
 							edt->stateEn = json_object_get_string(edt_state, "en");
 						}
-						else if (strcmp(info_member, "numericValue") == 0) {
+						else if (infoKeyword == EL_KEYWORD_NUMERIC_VALUE) {
 							edt->numericValue = json_object_get_number(edtInfo, "numericValue");
 						}
-						else if (strcmp(info_member, "readOnly") == 0) {
+						else if (infoKeyword == EL_KEYWORD_READ_ONLY) {
 							edt->edt_readOnly = json_object_get_boolean(edtInfo, "readOnly");
 						}
 						else {
@@ -300,8 +663,9 @@ void parse_data(iot_pnp *iot_pnp, JSON_Object *data, data_info *dataInfo)
 			else if (dataInfo->type == DATA_TYPE_NUMBER) {
 				size_t count = json_array_get_count(data_enum);
 
-				if (dataInfo->number_enum != NULL)
+				if (owns_array(dataInfo, dataInfo->number_enum))
 					DebugBreak();
+				dataInfo->numberEnumCount = (int)count;
 
 				switch (dataInfo->numFormat) {
 				case NUMBER_FORMAT_INT8: {
@@ -393,7 +757,7 @@ void parse_data(iot_pnp *iot_pnp, JSON_Object *data, data_info *dataInfo)
 				continue;
 			}
 		}
-		else if (strcmp(member, "properties") == 0) {
+		else if (memberKeyword == EL_KEYWORD_PROPERTIES) {
 			JSON_Array *data_properties;
 
 			data_properties = json_object_get_array(data, "properties");
@@ -404,7 +768,7 @@ void parse_data(iot_pnp *iot_pnp, JSON_Object *data, data_info *dataInfo)
 
 			int dataInfoCount = json_array_get_count(data_properties);
 			data_info *dataInfo2 = (data_info *)malloc(sizeof(data_info) * dataInfoCount);
-			if (dataInfo->dataInfos != NULL)
+			if (owns_array(dataInfo, dataInfo->dataInfos))
 				DebugBreak();
 
 			dataInfo->dataInfoCount = dataInfoCount;
@@ -423,11 +787,12 @@ void parse_data(iot_pnp *iot_pnp, JSON_Object *data, data_info *dataInfo)
 
 				for (int l = 0; l < json_object_get_count(propInfo); l++) {
 					const char *info_member = json_object_get_name(propInfo, l);
+					el_keyword infoKeyword = el_get_keyword(info_member);
 
-					if (strcmp(info_member, "name") == 0) {
+					if (infoKeyword == EL_KEYWORD_NAME) {
 						dataInfo2->name = json_object_get_string(propInfo, "name");
 					}
-					else if (strcmp(info_member, "element") == 0) {
+					else if (infoKeyword == EL_KEYWORD_ELEMENT) {
 						JSON_Object *element = json_object_get_object(propInfo, "element");
 
 						parse_data(iot_pnp, element, dataInfo2);
@@ -439,37 +804,37 @@ void parse_data(iot_pnp *iot_pnp, JSON_Object *data, data_info *dataInfo)
 				}
 			}
 		}
-		else if (strcmp(member, "unit") == 0) {
+		else if (memberKeyword == EL_KEYWORD_UNIT) {
 			dataInfo->unit = json_object_get_string(data, "unit");
 		}
-		else if (strcmp(member, "multipleOf") == 0) {
+		else if (memberKeyword == EL_KEYWORD_MULTIPLE_OF) {
 			dataInfo->multipleOf = json_object_get_number(data, "multipleOf");
 		}
-		else if (strcmp(member, "minSize") == 0) {
+		else if (memberKeyword == EL_KEYWORD_MIN_SIZE) {
 			dataInfo->minSize = json_object_get_number(data, "minSize");
 		}
-		else if (strcmp(member, "maxSize") == 0) {
+		else if (memberKeyword == EL_KEYWORD_MAX_SIZE) {
 			dataInfo->maxSize = json_object_get_number(data, "maxSize");
 		}
-		else if (strcmp(member, "itemSize") == 0) {
+		else if (memberKeyword == EL_KEYWORD_ITEM_SIZE) {
 			dataInfo->itemSize = (int)json_object_get_number(data, "itemSize");
 		}
-		else if (strcmp(member, "minItems") == 0) {
+		else if (memberKeyword == EL_KEYWORD_MIN_ITEMS) {
 			dataInfo->minItems = (int)json_object_get_number(data, "minItems");
 		}
-		else if (strcmp(member, "maxItems") == 0) {
+		else if (memberKeyword == EL_KEYWORD_MAX_ITEMS) {
 			dataInfo->maxItems = (int)json_object_get_number(data, "maxItems");
 		}
-		else if (strcmp(member, "base") == 0) {
+		else if (memberKeyword == EL_KEYWORD_BASE) {
 			dataInfo->base = json_object_get_string(data, "base");
 		}
-		else if (strcmp(member, "minimum") == 0) {
+		else if (memberKeyword == EL_KEYWORD_MINIMUM) {
 			dataInfo->minimum = (int)json_object_get_number(data, "minimum");
 		}
-		else if (strcmp(member, "maximum") == 0) {
+		else if (memberKeyword == EL_KEYWORD_MAXIMUM) {
 			dataInfo->maximum = (int)json_object_get_number(data, "maximum");
 		}
-		else if (strcmp(member, "coefficient") == 0) {
+		else if (memberKeyword == EL_KEYWORD_COEFFICIENT) {
 			JSON_Array *coefficient = json_object_get_array(data, "coefficient");
 			if (coefficient == NULL) {
 				DebugBreak();
@@ -478,7 +843,7 @@ void parse_data(iot_pnp *iot_pnp, JSON_Object *data, data_info *dataInfo)
 
 			int count = json_array_get_count(coefficient);
 			const char **epcs = (const char **)malloc(sizeof(const char *) * count);
-			if (dataInfo->coefficientEpcs != NULL)
+			if (owns_array(dataInfo, dataInfo->coefficientEpcs))
 				DebugBreak();
 			dataInfo->coefficientEpcCount = count;
 			dataInfo->coefficientEpcs = epcs;
@@ -495,7 +860,7 @@ void parse_data(iot_pnp *iot_pnp, JSON_Object *data, data_info *dataInfo)
 				*epcs = epc;
 			}
 		}
-		else if (strcmp(member, "items") == 0) {
+		else if (memberKeyword == EL_KEYWORD_ITEMS) {
 			JSON_Object *data2;
 
 			data2 = json_object_get_object(data, "items");
@@ -506,7 +871,7 @@ void parse_data(iot_pnp *iot_pnp, JSON_Object *data, data_info *dataInfo)
 
 			int dataInfoCount = 1;
 			data_info *dataInfo2 = (data_info *)malloc(sizeof(data_info) * dataInfoCount);
-			if (dataInfo->dataInfos != NULL)
+			if (owns_array(dataInfo, dataInfo->dataInfos))
 				DebugBreak();
 
 			dataInfo->dataInfoCount = dataInfoCount;
@@ -516,7 +881,7 @@ void parse_data(iot_pnp *iot_pnp, JSON_Object *data, data_info *dataInfo)
 
 			parse_data(iot_pnp, data2, dataInfo2);
 		}
-		else if (strcmp(member, "bitmaps") == 0) {
+		else if (memberKeyword == EL_KEYWORD_BITMAPS) {
 			JSON_Array *bitmaps;
 
 			bitmaps = json_object_get_array(data, "bitmaps");
@@ -527,7 +892,7 @@ void parse_data(iot_pnp *iot_pnp, JSON_Object *data, data_info *dataInfo)
 
 			int bitmapInfoCount = json_array_get_count(bitmaps);
 			bitmap_info *bitmapInfo = (bitmap_info *)malloc(sizeof(bitmap_info) * bitmapInfoCount);
-			if (dataInfo->bitmapInfos != NULL)
+			if (owns_array(dataInfo, dataInfo->bitmapInfos))
 				DebugBreak();
 
 			dataInfo->bitmapInfoCount = bitmapInfoCount;
@@ -546,11 +911,12 @@ void parse_data(iot_pnp *iot_pnp, JSON_Object *data, data_info *dataInfo)
 
 				for (int l = 0; l < json_object_get_count(bitmap); l++) {
 					const char *info_member = json_object_get_name(bitmap, l);
+					el_keyword infoKeyword = el_get_keyword(info_member);
 
-					if (strcmp(info_member, "name") == 0) {
+					if (infoKeyword == EL_KEYWORD_NAME) {
 						bitmapInfo->name = json_object_get_string(bitmap, "name");
 					}
-					else if (strcmp(info_member, "descriptions") == 0) {
+					else if (infoKeyword == EL_KEYWORD_DESCRIPTIONS) {
 						JSON_Object *description;
 
 						description = json_object_get_object(bitmap, "descriptions");
@@ -562,7 +928,7 @@ void parse_data(iot_pnp *iot_pnp, JSON_Object *data, data_info *dataInfo)
 						bitmapInfo->descriptionsJa = json_object_get_string(description, "ja");
 						bitmapInfo->descriptionsEn = json_object_get_string(description, "en");
 					}
-					else if (strcmp(info_member, "position") == 0) {
+					else if (infoKeyword == EL_KEYWORD_POSITION) {
 						JSON_Object *position;
 
 						position = json_object_get_object(bitmap, "position");
@@ -573,8 +939,12 @@ void parse_data(iot_pnp *iot_pnp, JSON_Object *data, data_info *dataInfo)
 
 						bitmapInfo->index = (int)json_object_get_number(position, "index");
 						bitmapInfo->bitMask = json_object_get_string(position, "bitMask");
+						if (!compile_bit_mask(bitmapInfo)) {
+							DebugBreak();
+							continue;
+						}
 					}
-					else if (strcmp(info_member, "value") == 0) {
+					else if (infoKeyword == EL_KEYWORD_VALUE) {
 						JSON_Object *value = json_object_get_object(bitmap, "value");
 
 						parse_data(iot_pnp, value, &bitmapInfo->value);
@@ -586,7 +956,7 @@ void parse_data(iot_pnp *iot_pnp, JSON_Object *data, data_info *dataInfo)
 				}
 			}
 		}
-		else if (strcmp(member, "oneOf") == 0) {
+		else if (memberKeyword == EL_KEYWORD_ONE_OF) {
 			if (dataInfo->type != DATA_TYPE_NONE) {
 				DebugBreak();
 				continue;
@@ -602,7 +972,7 @@ void parse_data(iot_pnp *iot_pnp, JSON_Object *data, data_info *dataInfo)
 
 			int dataInfoCount = json_array_get_count(oneOf);
 			data_info *dataInfo2 = (data_info *)malloc(sizeof(data_info) * dataInfoCount);
-			if (dataInfo->dataInfos != NULL)
+			if (owns_array(dataInfo, dataInfo->dataInfos))
 				DebugBreak();
 
 			dataInfo->dataInfoCount = dataInfoCount;
@@ -622,25 +992,26 @@ void parse_data(iot_pnp *iot_pnp, JSON_Object *data, data_info *dataInfo)
 				parse_data(iot_pnp, data2, dataInfo2);
 			}
 		}
-		else if (strcmp(member, "format") == 0) {
+		else if (memberKeyword == EL_KEYWORD_FORMAT) {
 			const char *format = json_object_get_string(data, "format");
+			el_keyword formatKeyword = el_get_keyword(format);
 
-			if (strcmp(format, "int8") == 0) {
+			if (formatKeyword == EL_KEYWORD_INT8) {
 				dataInfo->numFormat = NUMBER_FORMAT_INT8;
 			}
-			else if (strcmp(format, "int16") == 0) {
+			else if (formatKeyword == EL_KEYWORD_INT16) {
 				dataInfo->numFormat = NUMBER_FORMAT_INT16;
 			}
-			else if (strcmp(format, "int32") == 0) {
+			else if (formatKeyword == EL_KEYWORD_INT32) {
 				dataInfo->numFormat = NUMBER_FORMAT_INT32;
 			}
-			else if (strcmp(format, "uint8") == 0) {
+			else if (formatKeyword == EL_KEYWORD_UINT8) {
 				dataInfo->numFormat = NUMBER_FORMAT_UINT8;
 			}
-			else if (strcmp(format, "uint16") == 0) {
+			else if (formatKeyword == EL_KEYWORD_UINT16) {
 				dataInfo->numFormat = NUMBER_FORMAT_UINT16;
 			}
-			else if (strcmp(format, "uint32") == 0) {
+			else if (formatKeyword == EL_KEYWORD_UINT32) {
 				dataInfo->numFormat = NUMBER_FORMAT_UINT32;
 			}
 			else {
@@ -648,38 +1019,401 @@ void parse_data(iot_pnp *iot_pnp, JSON_Object *data, data_info *dataInfo)
 				continue;
 			}
 		}
-		else if (strcmp(member, "$ref") == 0) {
-			const char *ref = json_object_get_string(data, "$ref");
-			dataInfo->ref = ref;
+		else if (memberKeyword == EL_KEYWORD_REF) {
+			// 先に引き継いである
+			continue;
+		}
+		else {
+			DebugBreak();
+			continue;
+		}
+	}
+}
 
-			if (strncmp(ref, "#/definitions/", 14) != 0) {
-				DebugBreak();
-				continue;
-			}
+void fill_image_data(el_image_builder *image, uint32_t offset, const data_info *dataInfo, bool shared);
 
-			JSON_Object *data2 = json_object_get_object(iot_pnp->el_definitions_object, &ref[14]);
-			if (data2 == NULL) {
-				DebugBreak();
-				continue;
-			}
+// 定義の配列は共有として登録し、プロパティが引き継いだときは同じ場所を指す
+uint32_t write_image_data_array(el_image_builder *image, const data_info *dataInfos, int count, bool shared)
+{
+	if ((dataInfos == NULL) || (count <= 0))
+		return 0;
 
-			parse_data(iot_pnp, data2, dataInfo);
+	uint32_t offset = el_image_find_shared(image, dataInfos);
+	if (offset != 0)
+		return offset;
+
+	offset = el_image_alloc(image, count * sizeof(el_image_data));
+	if (shared)
+		el_image_add_shared(image, dataInfos, offset);
+
+	for (int i = 0; i < count; i++) {
+		fill_image_data(image, offset + i * sizeof(el_image_data), &dataInfos[i], shared);
+	}
+
+	return offset;
+}
+
+// 列挙値がすべて1バイトに収まれば、EDTの配列の直後に番号を引く256バイトの表を置く
+// 表は配列と一緒に共有されるので、同じ定義を$refするプロパティは同じ表を使う
+bool has_state_table(const data_info *dataInfo)
+{
+	if ((dataInfo->edts == NULL) || (dataInfo->edtCount <= 0) || (dataInfo->edtCount >= EL_IMAGE_NO_STATE))
+		return false;
+
+	for (int i = 0; i < dataInfo->edtCount; i++) {
+		if ((dataInfo->edts[i].edt < 0) || (dataInfo->edts[i].edt > 0xFF))
+			return false;
+	}
+
+	return true;
+}
+
+uint32_t write_image_edts(el_image_builder *image, const data_info *dataInfo, bool shared)
+{
+	if ((dataInfo->edts == NULL) || (dataInfo->edtCount <= 0))
+		return 0;
+
+	uint32_t offset = el_image_find_shared(image, dataInfo->edts);
+	if (offset != 0)
+		return offset;
+
+	bool stateTable = has_state_table(dataInfo);
+	offset = el_image_alloc(image, dataInfo->edtCount * sizeof(el_image_edt) + (stateTable ? 256 : 0));
+	if (shared)
+		el_image_add_shared(image, dataInfo->edts, offset);
+
+	const edt_info *edt = dataInfo->edts;
+	for (int i = 0; i < dataInfo->edtCount; i++, edt++) {
+		uint32_t stateJa = el_image_add_string(image, edt->stateJa);
+		uint32_t stateEn = el_image_add_string(image, edt->stateEn);
+
+		el_image_edt *imageEdt = (el_image_edt *)el_image_at(image, offset + i * sizeof(el_image_edt));
+		if (imageEdt == NULL)
+			return 0;
+
+		imageEdt->edt = edt->edt;
+		imageEdt->stateJa = stateJa;
+		imageEdt->stateEn = stateEn;
+		imageEdt->readOnly = edt->edt_readOnly;
+		imageEdt->numericValue = edt->numericValue;
+	}
+
+	uint8_t *table = stateTable ? (uint8_t *)el_image_at(image, offset + dataInfo->edtCount * sizeof(el_image_edt)) : NULL;
+	if (table != NULL) {
+		// 同じEDTが複数あるときは最初のもの
+		memset(table, EL_IMAGE_NO_STATE, 256);
+		for (int i = dataInfo->edtCount - 1; i >= 0; i--) {
+			table[dataInfo->edts[i].edt] = (uint8_t)i;
 		}
-		else {
+	}
+
+	return offset;
+}
+
+uint32_t write_image_number_enum(el_image_builder *image, const data_info *dataInfo, bool shared)
+{
+	if ((dataInfo->number_enum == NULL) || (dataInfo->numberEnumCount <= 0))
+		return 0;
+
+	uint32_t offset = el_image_find_shared(image, dataInfo->number_enum);
+	if (offset != 0)
+		return offset;
+
+	offset = el_image_alloc(image, dataInfo->numberEnumCount * sizeof(int64_t));
+	if (shared)
+		el_image_add_shared(image, dataInfo->number_enum, offset);
+
+	int64_t *item = (int64_t *)el_image_at(image, offset);
+	if (item == NULL)
+		return 0;
+
+	for (int i = 0; i < dataInfo->numberEnumCount; i++, item++) {
+		switch (dataInfo->numFormat) {
+		case NUMBER_FORMAT_INT8:
+			*item = ((const int8_t *)dataInfo->number_enum)[i];
+			break;
+		case NUMBER_FORMAT_INT16:
+			*item = ((const int16_t *)dataInfo->number_enum)[i];
+			break;
+		case NUMBER_FORMAT_INT32:
+			*item = ((const int32_t *)dataInfo->number_enum)[i];
+			break;
+		case NUMBER_FORMAT_UINT8:
+			*item = ((const uint8_t *)dataInfo->number_enum)[i];
+			break;
+		case NUMBER_FORMAT_UINT16:
+			*item = ((const uint16_t *)dataInfo->number_enum)[i];
+			break;
+		case NUMBER_FORMAT_UINT32:
+			*item = ((const uint32_t *)dataInfo->number_enum)[i];
+			break;
+		default:
 			DebugBreak();
-			continue;
+			break;
+		}
+	}
+
+	return offset;
+}
+
+uint32_t write_image_coefficient_epcs(el_image_builder *image, const data_info *dataInfo, bool shared)
+{
+	if ((dataInfo->coefficientEpcs == NULL) || (dataInfo->coefficientEpcCount <= 0))
+		return 0;
+
+	uint32_t offset = el_image_find_shared(image, dataInfo->coefficientEpcs);
+	if (offset != 0)
+		return offset;
+
+	offset = el_image_alloc(image, dataInfo->coefficientEpcCount * sizeof(uint32_t));
+	if (shared)
+		el_image_add_shared(image, dataInfo->coefficientEpcs, offset);
+
+	uint32_t *epcs = (uint32_t *)el_image_at(image, offset);
+	if (epcs == NULL)
+		return 0;
+
+	for (int i = 0; i < dataInfo->coefficientEpcCount; i++) {
+		epcs[i] = (dataInfo->coefficientEpcs[i] != NULL) ? (uint32_t)strtol(dataInfo->coefficientEpcs[i], NULL, 16) : 0;
+	}
+
+	return offset;
+}
+
+uint32_t write_image_bitmaps(el_image_builder *image, const data_info *dataInfo, bool shared)
+{
+	if ((dataInfo->bitmapInfos == NULL) || (dataInfo->bitmapInfoCount <= 0))
+		return 0;
+
+	uint32_t offset = el_image_find_shared(image, dataInfo->bitmapInfos);
+	if (offset != 0)
+		return offset;
+
+	offset = el_image_alloc(image, dataInfo->bitmapInfoCount * sizeof(el_image_bitmap));
+	if (shared)
+		el_image_add_shared(image, dataInfo->bitmapInfos, offset);
+
+	const bitmap_info *bitmapInfo = dataInfo->bitmapInfos;
+	for (int i = 0; i < dataInfo->bitmapInfoCount; i++, bitmapInfo++) {
+		uint32_t bitmapOffset = offset + i * sizeof(el_image_bitmap);
+		uint32_t name = el_image_add_string(image, bitmapInfo->name);
+		uint32_t descriptionsJa = el_image_add_string(image, bitmapInfo->descriptionsJa);
+		uint32_t descriptionsEn = el_image_add_string(image, bitmapInfo->descriptionsEn);
+		uint32_t bitMask = el_image_add_string(image, bitmapInfo->bitMask);
+		fill_image_data(image, bitmapOffset + offsetof(el_image_bitmap, value), &bitmapInfo->value, shared);
+
+		el_image_bitmap *bitmap = (el_image_bitmap *)el_image_at(image, bitmapOffset);
+		if (bitmap == NULL)
+			return 0;
+
+		bitmap->name = name;
+		bitmap->descriptionsJa = descriptionsJa;
+		bitmap->descriptionsEn = descriptionsEn;
+		bitmap->index = bitmapInfo->index;
+		bitmap->bitMask = bitMask;
+		bitmap->mask = bitmapInfo->mask;
+		bitmap->shift = bitmapInfo->shift;
+	}
+
+	return offset;
+}
+
+// 子を先に書き込んでから自分を埋める（書き込むとバッファが動くので、ポインタは最後に取る）
+void fill_image_data(el_image_builder *image, uint32_t offset, const data_info *dataInfo, bool shared)
+{
+	uint32_t name = el_image_add_string(image, dataInfo->name);
+	uint32_t ref = el_image_add_string(image, dataInfo->ref);
+	uint32_t unit = el_image_add_string(image, dataInfo->unit);
+	uint32_t base = el_image_add_string(image, dataInfo->base);
+	uint32_t edts = write_image_edts(image, dataInfo, shared);
+	uint32_t numberEnum = write_image_number_enum(image, dataInfo, shared);
+	uint32_t coefficientEpcs = write_image_coefficient_epcs(image, dataInfo, shared);
+	uint32_t dataInfos = write_image_data_array(image, dataInfo->dataInfos, dataInfo->dataInfoCount, shared);
+	uint32_t bitmapInfos = write_image_bitmaps(image, dataInfo, shared);
+
+	el_image_data *data = (el_image_data *)el_image_at(image, offset);
+	if (data == NULL)
+		return;
+
+	data->type = (uint8_t)dataInfo->type;
+	data->numFormat = (uint8_t)dataInfo->numFormat;
+	data->size = dataInfo->size;
+	data->name = name;
+	data->ref = ref;
+	data->unit = unit;
+	data->base = base;
+	data->itemSize = dataInfo->itemSize;
+	data->minItems = dataInfo->minItems;
+	data->maxItems = dataInfo->maxItems;
+	data->minimum = dataInfo->minimum;
+	data->maximum = dataInfo->maximum;
+	data->edtCount = (edts != 0) ? dataInfo->edtCount : 0;
+	data->edts = edts;
+	data->numberEnumCount = (numberEnum != 0) ? dataInfo->numberEnumCount : 0;
+	data->numberEnum = numberEnum;
+	data->coefficientEpcCount = (coefficientEpcs != 0) ? dataInfo->coefficientEpcCount : 0;
+	data->coefficientEpcs = coefficientEpcs;
+	data->dataInfoCount = (dataInfos != 0) ? dataInfo->dataInfoCount : 0;
+	data->dataInfos = dataInfos;
+	data->bitmapInfoCount = (bitmapInfos != 0) ? dataInfo->bitmapInfoCount : 0;
+	data->bitmapInfos = bitmapInfos;
+	if ((edts != 0) && (dataInfo->size <= 1) && has_state_table(dataInfo)
+		&& ((dataInfo->type == DATA_TYPE_STATE) || (dataInfo->type == DATA_TYPE_NUMERIC_VALUE))) {
+		data->stateTable = edts + dataInfo->edtCount * sizeof(el_image_edt);
+	}
+	data->multipleOf = dataInfo->multipleOf;
+	data->minSize = dataInfo->minSize;
+	data->maxSize = dataInfo->maxSize;
+}
+
+// 定義を名前順に書き込む。定義の配列はイメージを保存するまで解放されない
+void write_image_definitions(iot_pnp *iot_pnp)
+{
+	el_image_builder *image = iot_pnp->image;
+	int count = iot_pnp->definitionInfoCount;
+	uint32_t definitions = el_image_alloc(image, count * sizeof(el_image_definition));
+
+	definition_info *definitionInfo = iot_pnp->definitionInfos;
+	for (int i = 0; i < count; i++, definitionInfo++) {
+		uint32_t name = el_image_add_string(image, definitionInfo->name);
+		uint32_t data = 0;
+		if (definitionInfo->compiled) {
+			data = el_image_alloc(image, sizeof(el_image_data));
+			fill_image_data(image, data, &definitionInfo->dataInfo, true);
+		}
+
+		el_image_definition *definition = (el_image_definition *)el_image_at(image, definitions + i * sizeof(el_image_definition));
+		if (definition == NULL)
+			return;
+
+		definition->name = name;
+		definition->data = data;
+	}
+
+	el_image_header *header = (el_image_header *)el_image_at(image, 0);
+	if (header == NULL)
+		return;
+
+	header->definitionCount = count;
+	header->definitions = definitions;
+}
+
+// データ定義の中で係数に使うEPCを集める
+void collect_coefficient_epcs(uint32_t *epcs, const data_info *dataInfo)
+{
+	for (int i = 0; i < dataInfo->coefficientEpcCount; i++) {
+		if (dataInfo->coefficientEpcs[i] != NULL) {
+			int epc = (int)strtol(dataInfo->coefficientEpcs[i], NULL, 16) & 0xFF;
+			epcs[epc / 32] |= 1u << (epc % 32);
+		}
+	}
+	for (int i = 0; i < dataInfo->dataInfoCount; i++) {
+		collect_coefficient_epcs(epcs, &dataInfo->dataInfos[i]);
+	}
+	for (int i = 0; i < dataInfo->bitmapInfoCount; i++) {
+		collect_coefficient_epcs(epcs, &dataInfo->bitmapInfos[i].value);
+	}
+}
+
+// プロパティの内容はすぐに書き込み、表は機器ごとにまとめるまでタスクにためておく
+void add_image_property(dt_task *task, int epc, unsigned short access_value, const char *validFrom, const char *validTo,
+	const char *propertyNameJa, const char *propertyNameEn, const data_info *dataInfo)
+{
+	el_image_builder *image = task->iot_pnp->image;
+
+	if (task->imagePropertyCount == task->imagePropertyCapacity) {
+		int capacity = (task->imagePropertyCapacity == 0) ? 64 : task->imagePropertyCapacity * 2;
+		el_image_property *properties = (el_image_property *)realloc(task->imageProperties, capacity * sizeof(el_image_property));
+		if (properties == NULL) {
+			DebugBreak();
+			return;
 		}
+		task->imageProperties = properties;
+		task->imagePropertyCapacity = capacity;
+	}
+
+	el_image_property *property = &task->imageProperties[task->imagePropertyCount++];
+	memset(property, 0, sizeof(*property));
+
+	property->epc = (uint8_t)epc;
+	property->getAccess = (uint8_t)((access_value >> 0) & 0xF);
+	property->setAccess = (uint8_t)((access_value >> 4) & 0xF);
+	property->infAccess = (uint8_t)((access_value >> 8) & 0xF);
+	property->validFrom = el_image_add_string(image, validFrom);
+	property->validTo = el_image_add_string(image, validTo);
+	property->validReleases = el_image_release_mask(validFrom, validTo);
+	property->propertyNameJa = el_image_add_string(image, propertyNameJa);
+	property->propertyNameEn = el_image_add_string(image, propertyNameEn);
+	property->data = el_image_alloc(image, sizeof(el_image_data));
+	fill_image_data(image, property->data, dataInfo, false);
+
+	collect_coefficient_epcs(task->coefficientEpcs, dataInfo);
+}
+
+// firstProperty以降にためたプロパティを機器の表として書き込む
+void add_image_device(dt_task *task, int firstProperty, const char *validFrom, const char *validTo,
+	const char *classNameJa, const char *classNameEn)
+{
+	el_image_builder *image = task->iot_pnp->image;
+	int count = task->imagePropertyCount - firstProperty;
+
+	task->imagePropertyCount = firstProperty;
+
+	// "oneOf"だけの機器は、選択肢の側で書き込み済み
+	if (classNameEn == NULL)
+		return;
+
+	el_image_device device;
+	memset(&device, 0, sizeof(device));
+
+	device.classCode = (uint16_t)task->classCode;
+	device.validFrom = el_image_add_string(image, validFrom);
+	device.validTo = el_image_add_string(image, validTo);
+	device.validReleases = el_image_release_mask(validFrom, validTo);
+	device.classNameJa = el_image_add_string(image, classNameJa);
+	device.classNameEn = el_image_add_string(image, classNameEn);
+	device.propertyCount = count;
+	device.properties = el_image_alloc(image, count * sizeof(el_image_property));
+
+	el_image_property *properties = (el_image_property *)el_image_at(image, device.properties);
+	if (properties == NULL)
+		return;
+
+	// プロパティのリリースは機器の範囲に収める
+	memcpy(properties, &task->imageProperties[firstProperty], count * sizeof(el_image_property));
+	for (int i = 0; i < count; i++) {
+		properties[i].validReleases &= device.validReleases;
+		if (task->coefficientEpcs[properties[i].epc / 32] & (1u << (properties[i].epc % 32)))
+			properties[i].flags |= EL_IMAGE_PROPERTY_COEFFICIENT;
 	}
+	el_image_add_device(image, &device);
 }
 
-void make_dt_interface(iot_pnp *iot_pnp, int index, unsigned short access_value,
+void make_dt_interface(dt_task *task, int index, unsigned short access_value,
 	const char *propertyNameJa, const char *propertyNameEn, data_info *dataInfo);
 
-#define ALL_ACCESS_RULE(g,s,i) (((i & 0xF) << 8) | ((s & 0xF) << 4) | ((g & 0xF) << 0))
+// リリースを指定したときは、validRelease（機器はfirstReleaseも）にそのリリースを含まないものを変換しない
+bool is_valid_release(iot_pnp *iot_pnp, JSON_Object *object)
+{
+	if (iot_pnp->release == EL_RELEASE_LATEST)
+		return true;
+
+	const char *from = json_object_get_string(object, "firstRelease");
+	const char *to = NULL;
+	JSON_Object *validRelease = json_object_get_object(object, "validRelease");
+	if (validRelease != NULL) {
+		from = json_object_get_string(validRelease, "from");
+		to = json_object_get_string(validRelease, "to");
+	}
+
+	return (el_image_release_mask(from, to) & el_image_release_bit(iot_pnp->release)) != 0;
+}
 
-void parse_property(iot_pnp *iot_pnp, JSON_Object *elProperty)
+void parse_property(dt_task *task, int epc, JSON_Object *elProperty)
 {
 	const char *propertyNameJa = NULL, *propertyNameEn = NULL;
+	const char *validFrom = NULL, *validTo = NULL;
+	bool hasOneOf = false;
 	union {
 		struct {
 			access_rule get_access : 4;
@@ -692,10 +1426,14 @@ void parse_property(iot_pnp *iot_pnp, JSON_Object *elProperty)
 
 	access_value = 0;
 
+	if (!is_valid_release(task->iot_pnp, elProperty))
+		return;
+
 	for (int i = 0; i < json_object_get_count(elProperty); i++) {
 		const char *propertyMember = json_object_get_name(elProperty, i);
+		el_keyword propertyKeyword = el_get_keyword(propertyMember);
 
-		if (strcmp(propertyMember, "validRelease") == 0) {
+		if (propertyKeyword == EL_KEYWORD_VALID_RELEASE) {
 			JSON_Object *validRelease;
 
 			validRelease = json_object_get_object(elProperty, "validRelease");
@@ -703,8 +1441,11 @@ void parse_property(iot_pnp *iot_pnp, JSON_Object *elProperty)
 				DebugBreak();
 				continue;
 			}
+
+			validFrom = json_object_get_string(validRelease, "from");
+			validTo = json_object_get_string(validRelease, "to");
 		}
-		else if (strcmp(propertyMember, "propertyName") == 0) {
+		else if (propertyKeyword == EL_KEYWORD_PROPERTY_NAME) {
 			JSON_Object *propertyName;
 
 			propertyName = json_object_get_object(elProperty, "propertyName");
@@ -716,7 +1457,7 @@ void parse_property(iot_pnp *iot_pnp, JSON_Object *elProperty)
 			propertyNameJa = json_object_get_string(propertyName, "ja");
 			propertyNameEn = json_object_get_string(propertyName, "en");
 		}
-		else if (strcmp(propertyMember, "accessRule") == 0) {
+		else if (propertyKeyword == EL_KEYWORD_ACCESS_RULE) {
 			JSON_Object *accessRule;
 
 			accessRule = json_object_get_object(elProperty, "accessRule");
@@ -727,6 +1468,7 @@ void parse_property(iot_pnp *iot_pnp, JSON_Object *elProperty)
 
 			for (int j = 0; j < json_object_get_count(accessRule); j++) {
 				const char *access = json_object_get_name(accessRule, j);
+				el_keyword accessKeyword = el_get_keyword(access);
 				const char *rule;
 
 				rule = json_object_get_string(accessRule, access);
@@ -735,13 +1477,13 @@ void parse_property(iot_pnp *iot_pnp, JSON_Object *elProperty)
 					continue;
 				}
 
-				if (strcmp(access, "get") == 0) {
+				if (accessKeyword == EL_KEYWORD_GET) {
 					get_access = get_access_rule(rule);
 				}
-				else if (strcmp(access, "set") == 0) {
+				else if (accessKeyword == EL_KEYWORD_SET) {
 					set_access = get_access_rule(rule);
 				}
-				else if (strcmp(access, "inf") == 0) {
+				else if (accessKeyword == EL_KEYWORD_INF) {
 					inf_access = get_access_rule(rule);
 				}
 				else {
@@ -750,7 +1492,7 @@ void parse_property(iot_pnp *iot_pnp, JSON_Object *elProperty)
 				}
 			}
 		}
-		else if (strcmp(propertyMember, "data") == 0) {
+		else if (propertyKeyword == EL_KEYWORD_DATA) {
 			JSON_Object *data;
 
 			data = json_object_get_object(elProperty, "data");
@@ -759,9 +1501,9 @@ void parse_property(iot_pnp *iot_pnp, JSON_Object *elProperty)
 				continue;
 			}
 
-			parse_data(iot_pnp, data, &dataInfoImpl);
+			parse_data(task->iot_pnp, data, &dataInfoImpl);
 		}
-		else if (strcmp(propertyMember, "oneOf") == 0) {
+		else if (propertyKeyword == EL_KEYWORD_ONE_OF) {
 			JSON_Array *oneOf;
 
 			oneOf = json_object_get_array(elProperty, "oneOf");
@@ -770,6 +1512,8 @@ void parse_property(iot_pnp *iot_pnp, JSON_Object *elProperty)
 				continue;
 			}
 
+			hasOneOf = true;
+
 			for (int j = 0; j < json_array_get_count(oneOf); j++) {
 				JSON_Object *elProperty2;
 
@@ -779,10 +1523,10 @@ void parse_property(iot_pnp *iot_pnp, JSON_Object *elProperty)
 					continue;
 				}
 
-				parse_property(iot_pnp, elProperty2);
+				parse_property(task, epc, elProperty2);
 			}
 		}
-		else if (strcmp(propertyMember, "atomic") == 0) {
+		else if (propertyKeyword == EL_KEYWORD_ATOMIC) {
 			const char *atomic;
 
 			atomic = json_object_get_string(elProperty, "atomic");
@@ -791,7 +1535,7 @@ void parse_property(iot_pnp *iot_pnp, JSON_Object *elProperty)
 				continue;
 			}
 		}
-		else if (strcmp(propertyMember, "note") == 0) {
+		else if (propertyKeyword == EL_KEYWORD_NOTE) {
 			JSON_Object *note;
 
 			note = json_object_get_object(elProperty, "note");
@@ -809,34 +1553,181 @@ void parse_property(iot_pnp *iot_pnp, JSON_Object *elProperty)
 	if (dataInfoImpl.type == DATA_TYPE_ONE_OF) {
 		data_info *dataInfo = dataInfoImpl.dataInfos;
 		for (int i = 0; i < dataInfoImpl.dataInfoCount; i++, dataInfo++) {
-			make_dt_interface(iot_pnp, i + 1, access_value, propertyNameJa, propertyNameEn, dataInfo);
+			make_dt_interface(task, i + 1, access_value, propertyNameJa, propertyNameEn, dataInfo);
 		}
 	}
 	else {
-		make_dt_interface(iot_pnp, 0, access_value, propertyNameJa, propertyNameEn, &dataInfoImpl);
+		make_dt_interface(task, 0, access_value, propertyNameJa, propertyNameEn, &dataInfoImpl);
+	}
+
+	// "oneOf"の選択肢は、それぞれのプロパティとして書き込み済み
+	if ((task->iot_pnp->image != NULL) && !hasOneOf) {
+		add_image_property(task, epc, access_value, validFrom, validTo, propertyNameJa, propertyNameEn, &dataInfoImpl);
 	}
 
 	free_data_info(&dataInfoImpl);
 }
 
-JSON_Value *make_schema(data_info *dataInfo)
+// 同じ内容のスキーマを探す。ハッシュが同じでも、シリアライズした文字列が同じものだけを同じとする
+dt_schema *find_schema(dt_task *task, uint64_t hash, const char *text)
 {
-	JSON_Value *result;
+	if (task->dt_schemaSlotCount == 0)
+		return NULL;
+
+	uint32_t mask = task->dt_schemaSlotCount - 1;
+	for (uint32_t slot = (uint32_t)hash & mask; task->dt_schemaSlots[slot] != 0; slot = (slot + 1) & mask) {
+		dt_schema *dt_schema = &task->dt_schemas[task->dt_schemaSlots[slot] - 1];
+		if ((dt_schema->hash == hash) && (strcmp(dt_schema->text, text) == 0))
+			return dt_schema;
+	}
 
-	switch (dataInfo->type) {
-	case DATA_TYPE_STATE: {
-		result = json_value_init_object();
-		JSON_Object *schema = json_value_get_object(result);
-		json_object_set_string(schema, "@type", "Enum");
-		json_object_set_string(schema, "valueSchema", "integer");
+	return NULL;
+}
 
-		JSON_Value *enumValues_value = json_value_init_array();
-		JSON_Array *enumValues = json_value_get_array(enumValues_value);
-		json_object_set_value(schema, "enumValues", enumValues_value);
+// スキーマの表（番号+1、0は空き）は半分まで使ったら大きくする
+bool grow_schema_slots(dt_task *task)
+{
+	if ((task->dt_schemaCount + 1) * 2 <= task->dt_schemaSlotCount)
+		return true;
+
+	int slotCount = (task->dt_schemaSlotCount == 0) ? 64 : task->dt_schemaSlotCount * 2;
+	int *slots = (int *)calloc(slotCount, sizeof(int));
+	if (slots == NULL)
+		return false;
+
+	uint32_t mask = slotCount - 1;
+	for (int i = 0; i < task->dt_schemaCount; i++) {
+		uint32_t slot = (uint32_t)task->dt_schemas[i].hash & mask;
+		while (slots[slot] != 0)
+			slot = (slot + 1) & mask;
+		slots[slot] = i + 1;
+	}
 
-		edt_info *edt = dataInfo->edts;
+	free(task->dt_schemaSlots);
+	task->dt_schemaSlots = slots;
+	task->dt_schemaSlotCount = slotCount;
+	return true;
+}
+
+// インターフェースが変わったら、前のインターフェースのスキーマは使わない
+void clear_schemas(dt_task *task)
+{
+	for (int i = 0; i < task->dt_schemaCount; i++) {
+		free(task->dt_schemas[i].text);
+	}
+	if (task->dt_schemaSlots != NULL) {
+		memset(task->dt_schemaSlots, 0, task->dt_schemaSlotCount * sizeof(int));
+	}
+
+	task->dt_schemas_value = NULL;
+	task->dt_schemas_array = NULL;
+	task->dt_schemaCount = 0;
+}
+
+// 同じ内容のスキーマがあればそのIDを、なければスキーマをschemasに加えて新しいIDを返す
+// 中のスキーマは先にIDに置き換わっているので、内容が同じならシリアライズした文字列も同じになる
+// IDはインターフェースの@idの下に作るので、ほかのインターフェースのスキーマとは重ならない
+JSON_Value *share_schema(dt_task *task, JSON_Value *schema, const data_info *dataInfo)
+{
+	if (!task->iot_pnp->sharedSchemas || (json_value_get_type(schema) != JSONObject))
+		return schema;
+
+	size_t size = json_serialization_size(schema);
+	if (size > task->schemaTextSize) {
+		char *schemaText = (char *)realloc(task->schemaText, size);
+		if (schemaText == NULL) {
+			DebugBreak();
+			return schema;
+		}
+		task->schemaText = schemaText;
+		task->schemaTextSize = size;
+	}
+	if ((size == 0) || (json_serialize_to_buffer(schema, task->schemaText, size) != JSONSuccess)) {
+		DebugBreak();
+		return schema;
+	}
+
+	uint64_t hash = hash_text(task->schemaText);
+	dt_schema *found = find_schema(task, hash, task->schemaText);
+	if (found != NULL)
+		return json_value_init_string_arena(task->dt_arena, found->id);
+
+	if (task->dt_schemaCount == task->dt_schemaCapacity) {
+		int capacity = (task->dt_schemaCapacity == 0) ? 16 : task->dt_schemaCapacity * 2;
+		dt_schema *dt_schemas = (dt_schema *)realloc(task->dt_schemas, capacity * sizeof(dt_schema));
+		if (dt_schemas == NULL) {
+			DebugBreak();
+			return schema;
+		}
+		task->dt_schemas = dt_schemas;
+		task->dt_schemaCapacity = capacity;
+	}
+
+	char *text = (char *)malloc(size);
+	if ((text == NULL) || !grow_schema_slots(task)) {
+		DebugBreak();
+		free(text);
+		return schema;
+	}
+	memcpy(text, task->schemaText, size);
+
+	// 定義を参照しているときは定義の名前をIDに含める
+	char name[65] = "schema";
+	const char *ref = (dataInfo->ref != NULL) ? strrchr(dataInfo->ref, '/') : NULL;
+	if (ref != NULL) {
+		set_digital_twin_id(name, ref + 1, sizeof(name));
+	}
+
+	// ハッシュだけが同じ別の内容には番号を付けて、IDが重ならないようにする
+	char temp[512];
+	int index = task->dt_schemaCount;
+	sprintf_s(temp, "%s:%s_%016llx:1", task->dt_schemaScope, name, (unsigned long long)hash);
+	for (int i = 0; i < task->dt_schemaCount; i++) {
+		if (task->dt_schemas[i].hash == hash) {
+			sprintf_s(temp, "%s:%s_%016llx_%d:1", task->dt_schemaScope, name, (unsigned long long)hash, index);
+			break;
+		}
+	}
+	json_object_set_string(json_value_get_object(schema), "@id", temp);
+
+	if (task->dt_schemas_value == NULL) {
+		task->dt_schemas_value = json_value_init_array_arena(task->dt_arena);
+		task->dt_schemas_array = json_value_get_array(task->dt_schemas_value);
+	}
+	json_array_append_value(task->dt_schemas_array, schema);
+
+	dt_schema *dt_schema = &task->dt_schemas[task->dt_schemaCount++];
+	dt_schema->hash = hash;
+	dt_schema->id = json_object_get_string(json_value_get_object(schema), "@id");
+	dt_schema->text = text;
+
+	uint32_t mask = task->dt_schemaSlotCount - 1;
+	uint32_t slot = (uint32_t)hash & mask;
+	while (task->dt_schemaSlots[slot] != 0)
+		slot = (slot + 1) & mask;
+	task->dt_schemaSlots[slot] = task->dt_schemaCount;
+
+	return json_value_init_string_arena(task->dt_arena, dt_schema->id);
+}
+
+JSON_Value *make_schema(dt_task *task, data_info *dataInfo)
+{
+	JSON_Value *result;
+
+	switch (dataInfo->type) {
+	case DATA_TYPE_STATE: {
+		result = json_value_init_object_arena(task->dt_arena);
+		JSON_Object *schema = json_value_get_object(result);
+		json_object_set_string(schema, "@type", "Enum");
+		json_object_set_string(schema, "valueSchema", "integer");
+
+		JSON_Value *enumValues_value = json_value_init_array_arena(task->dt_arena);
+		JSON_Array *enumValues = json_value_get_array(enumValues_value);
+		json_object_set_value(schema, "enumValues", enumValues_value);
+
+		edt_info *edt = dataInfo->edts;
 		for (int i = 0; i < dataInfo->edtCount; i++, edt++) {
-			JSON_Value *enumValue_value = json_value_init_object();
+			JSON_Value *enumValue_value = json_value_init_object_arena(task->dt_arena);
 			JSON_Object *enumValue = json_value_get_object(enumValue_value);
 			json_array_append_value(enumValues, enumValue_value);
 
@@ -862,67 +1753,67 @@ JSON_Value *make_schema(data_info *dataInfo)
 		break;
 	}
 	case DATA_TYPE_OBJECT: {
-		result = json_value_init_object();
+		result = json_value_init_object_arena(task->dt_arena);
 		JSON_Object *schema = json_value_get_object(result);
 		json_object_set_string(schema, "@type", "Object");
 
-		JSON_Value *fields_value = json_value_init_array();
+		JSON_Value *fields_value = json_value_init_array_arena(task->dt_arena);
 		JSON_Array *fields = json_value_get_array(fields_value);
 		json_object_set_value(schema, "fields", fields_value);
 
 		data_info *dataInfo2 = dataInfo->dataInfos;
 		for (int i = 0; i < dataInfo->dataInfoCount; i++, dataInfo2++) {
-			JSON_Value *field_value = json_value_init_object();
+			JSON_Value *field_value = json_value_init_object_arena(task->dt_arena);
 			JSON_Object *field = json_value_get_object(field_value);
 			json_array_append_value(fields, field_value);
 
 			json_object_set_string(field, "name", dataInfo2->name);
-			JSON_Value *schema2 = make_schema(dataInfo2);
+			JSON_Value *schema2 = make_schema(task, dataInfo2);
 			json_object_set_value(field, "schema", schema2);
 		}
 		break;
 	}
 	case DATA_TYPE_DATE_TIME: {
-		result = json_value_init_string("datetime");
+		result = json_value_init_string_arena(task->dt_arena, "datetime");
 		break;
 	}
 	case DATA_TYPE_TIME: {
-		result = json_value_init_string("time");
+		result = json_value_init_string_arena(task->dt_arena, "time");
 		break;
 	}
 	case DATA_TYPE_RAW: {
-		result = json_value_init_string("string");
+		result = json_value_init_string_arena(task->dt_arena, "string");
 		break;
 	}
 	case DATA_TYPE_ARRAY: {
-		result = json_value_init_object();
+		result = json_value_init_object_arena(task->dt_arena);
 		JSON_Object *schema = json_value_get_object(result);
 		json_object_set_string(schema, "@type", "Array");
 		break;
 	}
 	case DATA_TYPE_BITMAP: {
-		result = json_value_init_object();
+		result = json_value_init_object_arena(task->dt_arena);
 		JSON_Object *schema = json_value_get_object(result);
 		json_object_set_string(schema, "@type", "Object");
 
-		JSON_Value *fields_value = json_value_init_array();
+		JSON_Value *fields_value = json_value_init_array_arena(task->dt_arena);
 		JSON_Array *fields = json_value_get_array(fields_value);
 		json_object_set_value(schema, "fields", fields_value);
 
 		bitmap_info *bitmapInfo = dataInfo->bitmapInfos;
 		for (int i = 0; i < dataInfo->bitmapInfoCount; i++, bitmapInfo++) {
-			JSON_Value *field_value = json_value_init_object();
+			JSON_Value *field_value = json_value_init_object_arena(task->dt_arena);
 			JSON_Object *field = json_value_get_object(field_value);
 			json_array_append_value(fields, field_value);
 
 			json_object_set_string(field, "name", bitmapInfo->name);
-			JSON_Value *schema2 = make_schema(&bitmapInfo->value);
+			JSON_Value *schema2 = make_schema(task, &bitmapInfo->value);
 			json_object_set_value(field, "schema", schema2);
 		}
 		break;
 	}
 	case DATA_TYPE_LEVEL: {
-		result = json_value_init_string("integer");
+		result = json_value_init_string_arena(task->dt_arena, "integer");
 		break;
 	}
 	case DATA_TYPE_NUMBER: {
@@ -932,10 +1823,10 @@ JSON_Value *make_schema(data_info *dataInfo)
 		case NUMBER_FORMAT_INT32:
 		case NUMBER_FORMAT_UINT8:
 		case NUMBER_FORMAT_UINT16:
-			result = json_value_init_string("integer");
+			result = json_value_init_string_arena(task->dt_arena, "integer");
 			break;
 		case NUMBER_FORMAT_UINT32:
-			result = json_value_init_string("long");
+			result = json_value_init_string_arena(task->dt_arena, "long");
 			break;
 		default:
 			result = NULL;
@@ -945,26 +1836,26 @@ JSON_Value *make_schema(data_info *dataInfo)
 		break;
 	}
 	case DATA_TYPE_NUMERIC_VALUE: {
-		result = json_value_init_string("integer");
+		result = json_value_init_string_arena(task->dt_arena, "integer");
 		break;
 	}
 	case DATA_TYPE_ONE_OF: {
-		result = json_value_init_object();
+		result = json_value_init_object_arena(task->dt_arena);
 		JSON_Object *schema = json_value_get_object(result);
 		json_object_set_string(schema, "@type", "Object");
 
-		JSON_Value *fields_value = json_value_init_array();
+		JSON_Value *fields_value = json_value_init_array_arena(task->dt_arena);
 		JSON_Array *fields = json_value_get_array(fields_value);
 		json_object_set_value(schema, "fields", fields_value);
 
 		data_info *dataInfo2 = dataInfo->dataInfos;
 		for (int i = 0; i < dataInfo->dataInfoCount; i++, dataInfo2++) {
-			JSON_Value *field_value = json_value_init_object();
+			JSON_Value *field_value = json_value_init_object_arena(task->dt_arena);
 			JSON_Object *field = json_value_get_object(field_value);
 			json_array_append_value(fields, field_value);
 
 			json_object_set_string(field, "name", dataInfo2->name);
-			JSON_Value *schema2 = make_schema(dataInfo2);
+			JSON_Value *schema2 = make_schema(task, dataInfo2);
 			json_object_set_value(field, "schema", schema2);
 		}
 		break;
@@ -975,12 +1866,12 @@ JSON_Value *make_schema(data_info *dataInfo)
 		break;
 	}
 
-	return result;
+	return share_schema(task, result, dataInfo);
 }
 
-JSON_Value *make_command_payload(const char *propertyNameJa, const char *propertyNameEn, data_info *dataInfo)
+JSON_Value *make_command_payload(dt_task *task, const char *propertyNameJa, const char *propertyNameEn, data_info *dataInfo)
 {
-	JSON_Value *command_value = json_value_init_object();
+	JSON_Value *command_value = json_value_init_object_arena(task->dt_arena);
 	JSON_Object *command = json_value_get_object(command_value);
 
 	char name[65];
@@ -993,7 +1884,7 @@ JSON_Value *make_command_payload(const char *propertyNameJa, const char *propert
 
 	json_object_set_string(command, "name", name);
 
-	JSON_Value *request = make_schema(dataInfo);
+	JSON_Value *request = make_schema(task, dataInfo);
 	json_object_set_value(command, "schema", request);
 
 	if (propertyNameJa != NULL) {
@@ -1010,76 +1901,25 @@ JSON_Value *make_command_payload(const char *propertyNameJa, const char *propert
 	return command_value;
 }
 
-void make_dt_interface(iot_pnp *iot_pnp, int index, unsigned short access_value,
+void make_dt_interface(dt_task *task, int index, unsigned short access_value,
 	const char *propertyNameJa, const char *propertyNameEn, data_info *dataInfo)
 {
 	if (propertyNameEn == NULL)
 		return;
 
-	dt_if_type if_type = DT_IF_TYPE_NONE;
-	bool writable = false;
+	const el_access_class *access = el_get_access_class((access_value >> 0) & 0xF, (access_value >> 4) & 0xF,
+		(access_value >> 8) & 0xF);
+	dt_if_type if_type = el_get_if_type(access, dataInfo->type);
+	bool writable = access->writable;
 
-	switch (access_value)
-	{
-	case ALL_ACCESS_RULE(ACCESS_RULE_NA, ACCESS_RULE_OPTIONAL, ACCESS_RULE_NA):
-		// GETなし
-		if_type = DT_IF_TYPE_COMMAND;
-		break;
-	case ALL_ACCESS_RULE(ACCESS_RULE_NA, ACCESS_RULE_REQUIRED, ACCESS_RULE_OPTIONAL):
-		// GETなし
-		if_type = DT_IF_TYPE_COMMAND;
-		break;
-	case ALL_ACCESS_RULE(ACCESS_RULE_OPTIONAL, ACCESS_RULE_NA, ACCESS_RULE_REQUIRED):
-	case ALL_ACCESS_RULE(ACCESS_RULE_REQUIRED, ACCESS_RULE_NA, ACCESS_RULE_REQUIRED):
-	case ALL_ACCESS_RULE(ACCESS_RULE_BY_CASE, ACCESS_RULE_NA, ACCESS_RULE_REQUIRED):
-		// SETなし
-		if_type = DT_IF_TYPE_TELEMETRY;
-		break;
-	case ALL_ACCESS_RULE(ACCESS_RULE_OPTIONAL, ACCESS_RULE_NA, ACCESS_RULE_OPTIONAL):
-	case ALL_ACCESS_RULE(ACCESS_RULE_REQUIRED, ACCESS_RULE_NA, ACCESS_RULE_OPTIONAL):
-	case ALL_ACCESS_RULE(ACCESS_RULE_BY_CASE, ACCESS_RULE_NA, ACCESS_RULE_OPTIONAL):
-		// SETなし
-		if_type = (dataInfo->type == DATA_TYPE_STATE) ? DT_IF_TYPE_TELEMETRY : DT_IF_TYPE_PROPERTY;
-		break;
-	case ALL_ACCESS_RULE(ACCESS_RULE_REQUIRED, ACCESS_RULE_REQUIRED, ACCESS_RULE_NA):
-		// GET/SET
-		if_type = DT_IF_TYPE_PROPERTY;
-		writable = true;
-		break;
-	case ALL_ACCESS_RULE(ACCESS_RULE_OPTIONAL, ACCESS_RULE_OPTIONAL, ACCESS_RULE_REQUIRED):
-	case ALL_ACCESS_RULE(ACCESS_RULE_REQUIRED, ACCESS_RULE_OPTIONAL, ACCESS_RULE_REQUIRED):
-	case ALL_ACCESS_RULE(ACCESS_RULE_REQUIRED, ACCESS_RULE_REQUIRED, ACCESS_RULE_REQUIRED):
-	case ALL_ACCESS_RULE(ACCESS_RULE_BY_CASE, ACCESS_RULE_BY_CASE, ACCESS_RULE_REQUIRED):
-		// GET/SET
-		if_type = DT_IF_TYPE_PROPERTY;
-		writable = true;
-		break;
-	case ALL_ACCESS_RULE(ACCESS_RULE_OPTIONAL, ACCESS_RULE_OPTIONAL, ACCESS_RULE_OPTIONAL):
-		// GET/SET
-		if_type = DT_IF_TYPE_PROPERTY;
-		writable = true;
-		break;
-	case ALL_ACCESS_RULE(ACCESS_RULE_REQUIRED, ACCESS_RULE_OPTIONAL, ACCESS_RULE_OPTIONAL):
-	case ALL_ACCESS_RULE(ACCESS_RULE_BY_CASE, ACCESS_RULE_OPTIONAL, ACCESS_RULE_OPTIONAL):
-		// GET/SET
-		if_type = DT_IF_TYPE_PROPERTY;
-		writable = true;
-		break;
-	case ALL_ACCESS_RULE(ACCESS_RULE_REQUIRED, ACCESS_RULE_REQUIRED, ACCESS_RULE_OPTIONAL):
-	case ALL_ACCESS_RULE(ACCESS_RULE_BY_CASE, ACCESS_RULE_BY_CASE, ACCESS_RULE_OPTIONAL):
-		// GET/SET
-		if_type = DT_IF_TYPE_PROPERTY;
-		writable = true;
-		break;
-	default:
-		DebugBreak();
+	// GETもSETもないものは変換しない
+	if (if_type == DT_IF_TYPE_NONE)
 		return;
-	}
 
 	if ((if_type == DT_IF_TYPE_COMMAND) && (dataInfo->type == DATA_TYPE_STATE)) {
 		edt_info *edt = dataInfo->edts;
 		for (int i = 0; i < dataInfo->edtCount; i++, edt++) {
-			JSON_Value *command_value = json_value_init_object();
+			JSON_Value *command_value = json_value_init_object_arena(task->dt_arena);
 			JSON_Object *command = json_value_get_object(command_value);
 
 			char name[65];
@@ -1107,11 +1947,11 @@ void make_dt_interface(iot_pnp *iot_pnp, int index, unsigned short access_value,
 			json_object_set_string(command, "commandType", "synchronous");
 			//json_object_set_string(command, "commandType", "asynchronous");
 
-			json_array_append_value(iot_pnp->dt_contents_array, command_value);
+			json_array_append_value(task->dt_contents_array, command_value);
 		}
 	}
 	else {
-		JSON_Value *ifcnt = json_value_init_object();
+		JSON_Value *ifcnt = json_value_init_object_arena(task->dt_arena);
 		JSON_Object *if_content = json_value_get_object(ifcnt);
 
 		char name[65];
@@ -1150,7 +1990,7 @@ void make_dt_interface(iot_pnp *iot_pnp, int index, unsigned short access_value,
 		switch (if_type) {
 		case DT_IF_TYPE_TELEMETRY:
 		case DT_IF_TYPE_PROPERTY:
-			JSON_Value *request = make_schema(dataInfo);
+			JSON_Value *request = make_schema(task, dataInfo);
 			json_object_set_value(if_content, "schema", request);
 			break;
 		}
@@ -1167,9 +2007,9 @@ void make_dt_interface(iot_pnp *iot_pnp, int index, unsigned short access_value,
 		case DT_IF_TYPE_COMMAND: {
 			json_object_set_string(if_content, "commandType", "synchronous");
 			//json_object_set_string(if_content, "commandType", "asynchronous");
-			JSON_Value *request = make_command_payload(propertyNameJa, propertyNameEn, dataInfo);
+			JSON_Value *request = make_command_payload(task, propertyNameJa, propertyNameEn, dataInfo);
 			json_object_set_value(if_content, "request", request);
-			JSON_Value *response = make_command_payload(propertyNameJa, propertyNameEn, dataInfo);
+			JSON_Value *response = make_command_payload(task, propertyNameJa, propertyNameEn, dataInfo);
 			json_object_set_value(if_content, "response", response);
 			break;
 		}
@@ -1192,18 +2032,55 @@ void make_dt_interface(iot_pnp *iot_pnp, int index, unsigned short access_value,
 			return;
 		}
 
-		json_array_append_value(iot_pnp->dt_contents_array, ifcnt);
+		json_array_append_value(task->dt_contents_array, ifcnt);
+	}
+}
+
+void add_dt_interface(dt_task *task, JSON_Value *dt_interface)
+{
+	if (task->dt_interfaceCount == task->dt_interfaceCapacity) {
+		int capacity = (task->dt_interfaceCapacity == 0) ? 4 : task->dt_interfaceCapacity * 2;
+		JSON_Value **dt_interfaces = (JSON_Value **)realloc(task->dt_interfaces, capacity * sizeof(JSON_Value *));
+		if (dt_interfaces == NULL) {
+			DebugBreak();
+			return;
+		}
+		task->dt_interfaces = dt_interfaces;
+		task->dt_interfaceCapacity = capacity;
 	}
+
+	task->dt_interfaces[task->dt_interfaceCount++] = dt_interface;
 }
 
-void parse_device(iot_pnp *iot_pnp, JSON_Object *device)
+void parse_device(dt_task *task, JSON_Object *device)
 {
 	const char *classNameJa = NULL, *classNameEn = NULL;
+	const char *validFrom = NULL, *validTo = NULL, *firstRelease = NULL;
+	int firstImageProperty = task->imagePropertyCount;
+
+	if (!is_valid_release(task->iot_pnp, device))
+		return;
+
+	// "-s"のスキーマの@idは、このインターフェースの@idの下に作る
+	// 同じ機器のoneOfで2つ目以降のインターフェースは@idが同じになるので、番号を付けて分ける
+	char scope[256];
+	const char *outerScope = task->dt_schemaScope;
+	if (task->iot_pnp->sharedSchemas) {
+		const char *scopeName = json_object_dotget_string(device, "className.en");
+		strcpy_s(scope, "urn:EchonetLite:");
+		int len = strlen(scope);
+		len += set_digital_twin_id(&scope[len], (scopeName != NULL) ? scopeName : "schema", sizeof(scope) - len - 16);
+		if (task->dt_interfaceCount > 0) {
+			sprintf_s(&scope[len], sizeof(scope) - len, ":v%d", task->dt_interfaceCount + 1);
+		}
+		task->dt_schemaScope = scope;
+	}
 
 	for (int i = 0; i < json_object_get_count(device); i++) {
 		const char *deviceMember = json_object_get_name(device, i);
+		el_keyword deviceKeyword = el_get_keyword(deviceMember);
 
-		if (strcmp(deviceMember, "validRelease") == 0) {
+		if (deviceKeyword == EL_KEYWORD_VALID_RELEASE) {
 			JSON_Object *validRelease;
 
 			validRelease = json_object_get_object(device, "validRelease");
@@ -1211,8 +2088,11 @@ void parse_device(iot_pnp *iot_pnp, JSON_Object *device)
 				DebugBreak();
 				continue;
 			}
+
+			validFrom = json_object_get_string(validRelease, "from");
+			validTo = json_object_get_string(validRelease, "to");
 		}
-		else if (strcmp(deviceMember, "className") == 0) {
+		else if (deviceKeyword == EL_KEYWORD_CLASS_NAME) {
 			JSON_Object *className;
 
 			className = json_object_get_object(device, "className");
@@ -1224,7 +2104,7 @@ void parse_device(iot_pnp *iot_pnp, JSON_Object *device)
 			classNameJa = json_object_get_string(className, "ja");
 			classNameEn = json_object_get_string(className, "en");
 		}
-		else if (strcmp(deviceMember, "elProperties") == 0) {
+		else if (deviceKeyword == EL_KEYWORD_EL_PROPERTIES) {
 			JSON_Object *elProperties;
 
 			elProperties = json_object_get_object(device, "elProperties");
@@ -1243,23 +2123,21 @@ void parse_device(iot_pnp *iot_pnp, JSON_Object *device)
 					continue;
 				}
 
-				if (iot_pnp->dt_contents_value == NULL) {
-					iot_pnp->dt_contents_value = json_value_init_array();
-					iot_pnp->dt_contents_array = json_value_get_array(iot_pnp->dt_contents_value);
+				if (task->dt_contents_value == NULL) {
+					task->dt_contents_value = json_value_init_array_arena(task->dt_arena);
+					task->dt_contents_array = json_value_get_array(task->dt_contents_value);
 				}
-				parse_property(iot_pnp, elProperty);
+				parse_property(task, (int)strtol(propertieId, NULL, 16), elProperty);
 			}
 		}
-		else if (strcmp(deviceMember, "firstRelease") == 0) {
-			const char *firstRelease;
-
+		else if (deviceKeyword == EL_KEYWORD_FIRST_RELEASE) {
 			firstRelease = json_object_get_string(device, "firstRelease");
 			if (firstRelease == NULL) {
 				DebugBreak();
 				continue;
 			}
 		}
-		else if (strcmp(deviceMember, "oneOf") == 0) {
+		else if (deviceKeyword == EL_KEYWORD_ONE_OF) {
 			JSON_Array *oneOf;
 
 			oneOf = json_object_get_array(device, "oneOf");
@@ -1277,7 +2155,7 @@ void parse_device(iot_pnp *iot_pnp, JSON_Object *device)
 					continue;
 				}
 
-				parse_device(iot_pnp, device2);
+				parse_device(task, device2);
 			}
 		}
 		else {
@@ -1287,9 +2165,9 @@ void parse_device(iot_pnp *iot_pnp, JSON_Object *device)
 	}
 
 	if (classNameEn != NULL) {
-		JSON_Value *cm = json_value_init_object();
+		JSON_Value *cm = json_value_init_object_arena(task->dt_arena);
 		JSON_Object *dt_interface = json_value_get_object(cm);
-		json_array_append_value(iot_pnp->dt_root_array, cm);
+		add_dt_interface(task, cm);
 
 		char temp[256];
 		strcpy_s(temp, "urn:EchonetLite:");
@@ -1311,73 +2189,920 @@ void parse_device(iot_pnp *iot_pnp, JSON_Object *device)
 			json_object_set_string(dt_interface, "displayName", classNameEn);
 		}
 
-		json_object_set_value(dt_interface, "contents", iot_pnp->dt_contents_value);
+		if (task->dt_schemas_value != NULL) {
+			json_object_set_value(dt_interface, "schemas", task->dt_schemas_value);
+		}
+
+		json_object_set_value(dt_interface, "contents", task->dt_contents_value);
 	}
 	else {
-		json_value_free(iot_pnp->dt_contents_value);
+		json_value_free(task->dt_contents_value);
+		json_value_free(task->dt_schemas_value);
 	}
 
-	iot_pnp->dt_contents_value = NULL;
-	iot_pnp->dt_contents_array = NULL;
+	task->dt_contents_value = NULL;
+	task->dt_contents_array = NULL;
+	clear_schemas(task);
+	task->dt_schemaScope = outerScope;
+
+	if (task->iot_pnp->image != NULL) {
+		add_image_device(task, firstImageProperty, (validFrom != NULL) ? validFrom : firstRelease, validTo,
+			classNameJa, classNameEn);
+	}
 }
 
-#define MEM_DEBUG
+#define DT_CACHE_VERSION 1		// 変換の結果が変わるときは上げて、前回の出力を使わないようにする
 
-int main()
+int compare_dt_cache_entry(const void *a, const void *b)
 {
-#ifdef MEM_DEBUG
-	_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
-#endif
+	uint64_t fingerprintA = ((const dt_cache_entry *)a)->fingerprint;
+	uint64_t fingerprintB = ((const dt_cache_entry *)b)->fingerprint;
+	return (fingerprintA < fingerprintB) ? -1 : (fingerprintA > fingerprintB) ? 1 : 0;
+}
 
-	JSON_Value *el_root_value;
-	JSON_Object *el_root, *el_devices;
-	char filename[] = "AppendixData\\EL_DeviceDescription_3_1_5r4.json";
-	iot_pnp iot_pnp;
+// 機器の入力（参照している定義を含む）と、変換の指定のフィンガープリント
+uint64_t fingerprint_device(dt_task *task)
+{
+	iot_pnp *iot_pnp = task->iot_pnp;
+	uint64_t hash = hash_combine(14695981039346656037ull, DT_CACHE_VERSION);
+	hash = hash_combine(hash, task->classCode);
+	hash = hash_combine(hash, iot_pnp->release);
+	hash = hash_combine(hash, iot_pnp->sharedSchemas);
 
-	memset(&iot_pnp, 0, sizeof(iot_pnp));
+	return fingerprint_value(iot_pnp, json_object_get_wrapping_value(task->device), hash);
+}
 
-	el_root_value = json_parse_file(filename);
-	el_root = json_value_get_object(el_root_value);
-	if (el_root == NULL) {
+// 入力が前回と同じ機器は、前回の出力をタスクのアリーナに写して使う
+bool reuse_dt_task(dt_task *task)
+{
+	iot_pnp *iot_pnp = task->iot_pnp;
+	if (iot_pnp->cacheFilename == NULL)
+		return false;
+
+	task->fingerprint = fingerprint_device(task);
+
+	// イメージは機器を変換しないと作れない
+	if (iot_pnp->image != NULL)
+		return false;
+
+	dt_cache_entry key;
+	key.fingerprint = task->fingerprint;
+	const dt_cache_entry *entry = (const dt_cache_entry *)bsearch(&key, iot_pnp->cacheEntries,
+		iot_pnp->cacheEntryCount, sizeof(dt_cache_entry), compare_dt_cache_entry);
+	if (entry == NULL)
+		return false;
+
+	for (int i = 0; i < entry->interfaceCount; i++) {
+		JSON_Value *dt_interface = json_value_deep_copy_arena(
+			json_array_get_value(iot_pnp->cache_interfaces, entry->firstInterface + i), task->dt_arena);
+		// 写せなければ変換する
+		if (dt_interface == NULL) {
+			task->dt_interfaceCount = 0;
+			return false;
+		}
+		add_dt_interface(task, dt_interface);
+	}
+
+	return true;
+}
+
+// 機器一台分を変換し、入力のDOMを破棄する
+void run_dt_task(dt_task *task)
+{
+	if (!reuse_dt_task(task)) {
+		parse_device(task, task->device);
+	}
+
+	json_arena_free(task->el_arena);
+	task->el_arena = NULL;
+	task->device = NULL;
+}
+
+DWORD WINAPI dt_worker(LPVOID param)
+{
+	iot_pnp *iot_pnp = (struct iot_pnp *)param;
+
+	for (;;) {
+		EnterCriticalSection(&iot_pnp->taskLock);
+		while ((iot_pnp->nextTask == iot_pnp->taskCount) && !iot_pnp->noMoreTasks) {
+			SleepConditionVariableCS(&iot_pnp->taskAdded, &iot_pnp->taskLock, INFINITE);
+		}
+		if (iot_pnp->nextTask == iot_pnp->taskCount) {
+			LeaveCriticalSection(&iot_pnp->taskLock);
+			break;
+		}
+		dt_task *task = iot_pnp->tasks[iot_pnp->nextTask++];
+		LeaveCriticalSection(&iot_pnp->taskLock);
+
+		run_dt_task(task);
+	}
+
+	return 0;
+}
+
+void start_dt_workers(iot_pnp *iot_pnp, int threadCount)
+{
+	InitializeCriticalSection(&iot_pnp->taskLock);
+	InitializeConditionVariable(&iot_pnp->taskAdded);
+
+	if (threadCount <= 0)
+		return;
+
+	iot_pnp->threads = (HANDLE *)calloc(threadCount, sizeof(HANDLE));
+	if (iot_pnp->threads == NULL) {
+		DebugBreak();
+		return;
+	}
+
+	for (int i = 0; i < threadCount; i++) {
+		HANDLE thread = CreateThread(NULL, 0, dt_worker, iot_pnp, 0, NULL);
+		if (thread == NULL) {
+			DebugBreak();
+			break;
+		}
+		iot_pnp->threads[iot_pnp->threadCount++] = thread;
+	}
+}
+
+// 変換タスクを付録の順に登録する。スレッドがなければその場で変換する
+void add_dt_task(iot_pnp *iot_pnp, dt_task *task)
+{
+	EnterCriticalSection(&iot_pnp->taskLock);
+	if (iot_pnp->taskCount == iot_pnp->taskCapacity) {
+		int capacity = (iot_pnp->taskCapacity == 0) ? 128 : iot_pnp->taskCapacity * 2;
+		dt_task **tasks = (dt_task **)realloc(iot_pnp->tasks, capacity * sizeof(dt_task *));
+		if (tasks == NULL) {
+			LeaveCriticalSection(&iot_pnp->taskLock);
+			DebugBreak();
+			json_arena_free(task->el_arena);
+			json_arena_free(task->dt_arena);
+			free(task);
+			return;
+		}
+		iot_pnp->tasks = tasks;
+		iot_pnp->taskCapacity = capacity;
+	}
+	iot_pnp->tasks[iot_pnp->taskCount++] = task;
+	if (iot_pnp->threadCount == 0) {
+		iot_pnp->nextTask++;
+	}
+	WakeConditionVariable(&iot_pnp->taskAdded);
+	LeaveCriticalSection(&iot_pnp->taskLock);
+
+	if (iot_pnp->threadCount == 0) {
+		run_dt_task(task);
+	}
+}
+
+void stop_dt_workers(iot_pnp *iot_pnp)
+{
+	EnterCriticalSection(&iot_pnp->taskLock);
+	iot_pnp->noMoreTasks = true;
+	WakeAllConditionVariable(&iot_pnp->taskAdded);
+	LeaveCriticalSection(&iot_pnp->taskLock);
+
+	for (int i = 0; i < iot_pnp->threadCount; i++) {
+		WaitForSingleObject(iot_pnp->threads[i], INFINITE);
+		CloseHandle(iot_pnp->threads[i]);
+	}
+	free(iot_pnp->threads);
+
+	iot_pnp->threadCount = 0;
+	iot_pnp->threads = NULL;
+	DeleteCriticalSection(&iot_pnp->taskLock);
+}
+
+// 各機器の変換結果を付録の順に並べる
+void merge_dt_tasks(iot_pnp *iot_pnp)
+{
+	for (int i = 0; i < iot_pnp->taskCount; i++) {
+		dt_task *task = iot_pnp->tasks[i];
+		for (int j = 0; j < task->dt_interfaceCount; j++) {
+			json_array_append_value(iot_pnp->dt_root_array, task->dt_interfaces[j]);
+		}
+	}
+}
+
+// 前回の出力を読み込む。ファイルがないとき、内容が正しくないときは、キャッシュを使わずにすべての機器を変換する
+void load_dt_cache(iot_pnp *iot_pnp)
+{
+	iot_pnp->cache_arena = json_arena_init();
+	JSON_Object *cache = json_value_get_object(json_parse_file_arena(iot_pnp->cacheFilename, iot_pnp->cache_arena));
+	JSON_Array *devices = json_object_get_array(cache, "devices");
+	JSON_Array *interfaces = json_object_get_array(cache, "interfaces");
+
+	int count = (int)json_array_get_count(devices);
+	if ((count == 0) || (interfaces == NULL))
+		return;
+
+	dt_cache_entry *entries = (dt_cache_entry *)calloc(count, sizeof(dt_cache_entry));
+	if (entries == NULL)
+		return;
+
+	int interfaceCount = (int)json_array_get_count(interfaces);
+	int firstInterface = 0;
+	for (int i = 0; i < count; i++) {
+		JSON_Object *device = json_array_get_object(devices, i);
+		const char *fingerprint = json_object_get_string(device, "fingerprint");
+		JSON_Value *deviceInterfaceCount_value = json_object_get_value(device, "interfaceCount");
+		double deviceInterfaceCount = json_value_get_number(deviceInterfaceCount_value);
+
+		// フィンガープリントは16桁の16進数、インターフェースの数は残りのインターフェースの数以下の整数
+		if ((fingerprint == NULL) || (strlen(fingerprint) != 16) || (strspn(fingerprint, "0123456789abcdef") != 16)
+			|| (json_value_get_type(deviceInterfaceCount_value) != JSONNumber)
+			|| (deviceInterfaceCount < 0) || (deviceInterfaceCount > interfaceCount - firstInterface)
+			|| (deviceInterfaceCount != (int)deviceInterfaceCount)) {
+			free(entries);
+			return;
+		}
+
+		dt_cache_entry *entry = &entries[i];
+		entry->fingerprint = strtoull(fingerprint, NULL, 16);
+		entry->firstInterface = firstInterface;
+		entry->interfaceCount = (int)deviceInterfaceCount;
+		for (int j = 0; j < entry->interfaceCount; j++) {
+			if (json_array_get_object(interfaces, firstInterface + j) == NULL) {
+				free(entries);
+				return;
+			}
+		}
+		firstInterface += entry->interfaceCount;
+	}
+
+	// 機器に対応しないインターフェースが残るのは、このプログラムが書いたファイルではない
+	if (firstInterface != interfaceCount) {
+		free(entries);
+		return;
+	}
+
+	qsort(entries, count, sizeof(dt_cache_entry), compare_dt_cache_entry);
+	iot_pnp->cache_interfaces = interfaces;
+	iot_pnp->cacheEntries = entries;
+	iot_pnp->cacheEntryCount = count;
+}
+
+// キャッシュのファイルをマップしたままでは書き込めないので、変換が終わったら解放する
+void free_dt_cache(iot_pnp *iot_pnp)
+{
+	free(iot_pnp->cacheEntries);
+	json_arena_free(iot_pnp->cache_arena);
+
+	iot_pnp->cacheEntryCount = 0;
+	iot_pnp->cacheEntries = NULL;
+	iot_pnp->cache_interfaces = NULL;
+	iot_pnp->cache_arena = NULL;
+}
+
+// 機器ごとのフィンガープリントとインターフェースの数を、並べた出力と一緒に書き込む
+// 出力のDOMはキャッシュのDOMの"interfaces"に移す
+// 一時ファイルに書き込んでから置き換えるので、書き込めなかったときも前回のキャッシュは残る
+bool save_dt_cache(iot_pnp *iot_pnp)
+{
+	JSON_Value *cache_value = json_value_init_object();
+	JSON_Object *cache = json_value_get_object(cache_value);
+	JSON_Value *devices_value = json_value_init_array();
+	JSON_Array *devices = json_value_get_array(devices_value);
+	json_object_set_value(cache, "devices", devices_value);
+
+	for (int i = 0; i < iot_pnp->taskCount; i++) {
+		dt_task *task = iot_pnp->tasks[i];
+		JSON_Value *device_value = json_value_init_object();
+		JSON_Object *device = json_value_get_object(device_value);
+		json_array_append_value(devices, device_value);
+
+		char fingerprint[17];
+		sprintf_s(fingerprint, "%016llx", (unsigned long long)task->fingerprint);
+		json_object_set_string(device, "fingerprint", fingerprint);
+		json_object_set_number(device, "interfaceCount", task->dt_interfaceCount);
+	}
+
+	json_object_set_value(cache, "interfaces", iot_pnp->dt_root_value);
+	iot_pnp->dt_root_value = cache_value;
+	iot_pnp->dt_root_array = NULL;
+
+	char temp[MAX_PATH];
+	sprintf_s(temp, "%s.tmp", iot_pnp->cacheFilename);
+	if ((json_serialize_to_file(cache_value, temp) != JSONSuccess)
+		|| !MoveFileExA(temp, iot_pnp->cacheFilename, MOVEFILE_REPLACE_EXISTING)) {
+		DeleteFileA(temp);
+		return false;
+	}
+
+	return true;
+}
+
+bool write_text_file(const char *filename, const char *text)
+{
+	HANDLE file = CreateFileA(filename, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	DWORD size = (DWORD)strlen(text);
+	DWORD written = 0;
+	BOOL result = WriteFile(file, text, size, &written, NULL);
+	CloseHandle(file);
+
+	return result && (written == size);
+}
+
+// インターフェースごとに"@id.内容のハッシュ.json"のファイルに書き込み、一覧をmanifest.jsonに書く
+// 内容が変わればファイル名も変わるので、ファイルはいつまでもキャッシュできる
+bool write_dt_shards(iot_pnp *iot_pnp, const char *directory)
+{
+	if (!CreateDirectoryA(directory, NULL) && (GetLastError() != ERROR_ALREADY_EXISTS))
+		return false;
+
+	JSON_Value *manifest_value = json_value_init_object();
+	JSON_Object *manifest = json_value_get_object(manifest_value);
+	JSON_Value *interfaces_value = json_value_init_array();
+	JSON_Array *interfaces = json_value_get_array(interfaces_value);
+	json_object_set_value(manifest, "interfaces", interfaces_value);
+	bool result = true;
+
+	for (int i = 0; i < iot_pnp->taskCount; i++) {
+		dt_task *task = iot_pnp->tasks[i];
+		for (int j = 0; j < task->dt_interfaceCount; j++) {
+			char *text = json_serialize_to_string_pretty(task->dt_interfaces[j]);
+			if (text == NULL) {
+				result = false;
+				continue;
+			}
+
+			const char *id = json_object_get_string(json_value_get_object(task->dt_interfaces[j]), "@id");
+			char name[256];
+			int len = set_digital_twin_id(name, id, sizeof(name) - 32);
+			sprintf_s(&name[len], sizeof(name) - len, ".%016llx.json", (unsigned long long)hash_text(text));
+
+			char path[MAX_PATH];
+			sprintf_s(path, "%s\\%s", directory, name);
+			if (!write_text_file(path, text))
+				result = false;
+			json_free_serialized_string(text);
+
+			JSON_Value *entry_value = json_value_init_object();
+			JSON_Object *entry = json_value_get_object(entry_value);
+			json_array_append_value(interfaces, entry_value);
+
+			char classCode[8];
+			sprintf_s(classCode, "0x%04X", task->classCode);
+			json_object_set_string(entry, "@id", id);
+			json_object_set_string(entry, "classCode", classCode);
+			json_object_set_string(entry, "file", name);
+		}
+	}
+
+	char path[MAX_PATH];
+	sprintf_s(path, "%s\\manifest.json", directory);
+	if (json_serialize_to_file_pretty(manifest_value, path) != JSONSuccess)
+		result = false;
+	json_value_free(manifest_value);
+
+	return result;
+}
+
+void free_dt_tasks(iot_pnp *iot_pnp)
+{
+	for (int i = 0; i < iot_pnp->taskCount; i++) {
+		dt_task *task = iot_pnp->tasks[i];
+		json_arena_free(task->el_arena);
+		json_arena_free(task->dt_arena);
+		free(task->dt_interfaces);
+		clear_schemas(task);
+		free(task->dt_schemas);
+		free(task->dt_schemaSlots);
+		free(task->schemaText);
+		free(task->imageProperties);
+		free(task);
+	}
+	free(iot_pnp->tasks);
+
+	iot_pnp->taskCount = 0;
+	iot_pnp->taskCapacity = 0;
+	iot_pnp->tasks = NULL;
+}
+
+JSON_Status el_reader_start(void *context)
+{
+	el_reader *reader = (el_reader *)context;
+
+	reader->depth++;
+	return JSONSuccess;
+}
+
+JSON_Status el_reader_end(void *context)
+{
+	el_reader *reader = (el_reader *)context;
+
+	reader->depth--;
+	return JSONSuccess;
+}
+
+JSON_Status el_reader_key(void *context, const char *name)
+{
+	el_reader *reader = (el_reader *)context;
+
+	if (reader->depth == 1) {
+		el_keyword keyword = el_get_keyword(name);
+
+		reader->inMetaData = false;
+		reader->inDevices = false;
+		if ((keyword == EL_KEYWORD_META_DATA) && (reader->iot_pnp->image != NULL)) {
+			reader->inMetaData = true;
+			reader->handler.arena = reader->iot_pnp->el_arena;
+			return JSONSaxBuildValue;
+		}
+		else if (keyword == EL_KEYWORD_DEFINITIONS) {
+			// 定義は最後まで参照するので入力用のアリーナに読み込む
+			reader->handler.arena = reader->iot_pnp->el_arena;
+			return JSONSaxBuildValue;
+		}
+		else if (keyword == EL_KEYWORD_DEVICES) {
+			reader->inDevices = true;
+		}
+	}
+	else if ((reader->depth == 2) && reader->inDevices) {
+		// 機器は一台ずつ読み込み、変換したら破棄する
+		reader->classCode = (int)strtol(name, NULL, 16);
+		reader->handler.arena = json_arena_init();
+		return JSONSaxBuildValue;
+	}
+	return JSONSuccess;
+}
+
+JSON_Status el_reader_value(void *context, JSON_Value *value)
+{
+	el_reader *reader = (el_reader *)context;
+	iot_pnp *iot_pnp = reader->iot_pnp;
+
+	if (reader->inMetaData) {
+		JSON_Object *metaData = json_value_get_object(value);
+		uint32_t release = el_image_add_string(iot_pnp->image, json_object_get_string(metaData, "release"));
+		uint32_t appendixVersion = el_image_add_string(iot_pnp->image, json_object_get_string(metaData, "version"));
+
+		el_image_header *header = (el_image_header *)el_image_at(iot_pnp->image, 0);
+		if (header != NULL) {
+			header->release = release;
+			header->appendixVersion = appendixVersion;
+		}
+		return JSONSuccess;
+	}
+
+	if (!reader->inDevices) {
+		iot_pnp->el_definitions_value = value;
+		iot_pnp->el_definitions_object = json_value_get_object(value);
+		if (iot_pnp->el_definitions_object == NULL) {
+			return JSONFailure;
+		}
+
+		init_definition_infos(iot_pnp);
+		compile_definition_infos(iot_pnp);
+		if (iot_pnp->cacheFilename != NULL) {
+			fingerprint_definition_infos(iot_pnp);
+		}
+		if (iot_pnp->image != NULL) {
+			write_image_definitions(iot_pnp);
+		}
+		return JSONSuccess;
+	}
+
+	JSON_Object *device = json_value_get_object(value);
+	dt_task *task = (device != NULL) ? (dt_task *)calloc(1, sizeof(dt_task)) : NULL;
+	if (task == NULL) {
+		DebugBreak();
+		json_arena_free(reader->handler.arena);
+		reader->handler.arena = NULL;
+		return JSONSuccess;
+	}
+
+	// 入力のDOMはタスクに渡し、変換が終わったら破棄する
+	task->iot_pnp = iot_pnp;
+	task->classCode = reader->classCode;
+	task->el_arena = reader->handler.arena;
+	task->device = device;
+	task->dt_arena = json_arena_init();
+	reader->handler.arena = NULL;
+
+	add_dt_task(iot_pnp, task);
+	return JSONSuccess;
+}
+
+// 変換済みのイメージから機器の一覧を表示する
+int print_el_image(const char *filename)
+{
+	const el_image_header *image = el_image_open(filename);
+	if (image == NULL)
 		return -1;
+
+	const char *appendixVersion = el_image_get_string(image, image->appendixVersion);
+	const char *release = el_image_get_string(image, image->release);
+	printf("%s %s\n", (appendixVersion != NULL) ? appendixVersion : "", (release != NULL) ? release : "");
+
+	const el_image_device *device = (const el_image_device *)el_image_get(image, image->devices);
+	for (uint32_t i = 0; i < image->deviceCount; i++, device++) {
+		printf("0x%04X %s (%u)\n", device->classCode, el_image_get_string(image, device->classNameEn), device->propertyCount);
 	}
 
-	iot_pnp.el_definitions_value = json_object_get_value(el_root, "definitions");
-	if (iot_pnp.el_definitions_value == NULL) {
+	el_image_close(image);
+	return 0;
+}
+
+// 値を一行ずつ表示する。戻り値は次の兄弟の位置
+int print_el_value(const el_image_header *image, const el_value *values, int index, int depth)
+{
+	const el_value *value = &values[index];
+
+	printf("%*s", depth * 2, "");
+	if (value->name != NULL)
+		printf("%s: ", value->name);
+
+	switch (value->type) {
+	case EL_VALUE_INTEGER:
+		printf("%lld", (long long)value->integer);
+		if (value->number != (double)value->integer)
+			printf(" (%g)", value->number);
+		if (value->flags & EL_VALUE_NO_COEFFICIENT)
+			printf(" (no coefficient)");
+		break;
+	case EL_VALUE_NUMBER:
+		printf("%g", value->number);
+		break;
+	case EL_VALUE_ENUM: {
+		const el_image_edt *edt = (const el_image_edt *)el_image_get(image, value->data->edts);
+		const char *stateEn = el_image_get_string(image, edt[value->index].stateEn);
+		printf("0x%llX %s", (long long)value->integer, (stateEn != NULL) ? stateEn : "");
+		break;
+	}
+	case EL_VALUE_STRING:
+		printf("%s", value->text);
+		break;
+	case EL_VALUE_RAW:
+		for (int i = 0; i < value->rawLength; i++) {
+			printf("%02X", value->raw[i]);
+		}
+		break;
+	case EL_VALUE_OBJECT:
+		printf("{");
+		break;
+	case EL_VALUE_ARRAY:
+		printf("[");
+		break;
+	default:
+		break;
+	}
+	printf("\n");
+
+	for (index++; index < value->end; ) {
+		index = print_el_value(image, values, index, depth + 1);
+	}
+
+	return index;
+}
+
+// 16進数の文字列をバイト列にする
+int read_hex(const char *hex_str, uint8_t *data, int capacity)
+{
+	int length = 0;
+	for (const char *s = hex_str; (s[0] != '\0') && (s[1] != '\0') && (length < capacity); s += 2) {
+		char hex[3] = { s[0], s[1], '\0' };
+		data[length++] = (uint8_t)strtol(hex, NULL, 16);
+	}
+
+	return length;
+}
+
+// イメージの定義でEDT（16進数の文字列）を変換して表示する
+int print_el_edt(const char *filename, int release, const char *classCode, const char *epc, const char *edt_str)
+{
+	const el_image_header *image = el_image_open(filename);
+	if (image == NULL)
 		return -1;
+
+	uint8_t edt[256];
+	int pdc = read_hex(edt_str, edt, sizeof(edt));
+
+	el_value values[256];
+	int valueCount;
+	el_edt_status status = el_edt_decode(image, (int)strtol(classCode, NULL, 16), (int)strtol(epc, NULL, 16), release,
+		edt, pdc, values, _countof(values), &valueCount);
+	if (status != EL_EDT_OK) {
+		printf("error %d\n", status);
 	}
 
-	iot_pnp.el_definitions_object = json_value_get_object(iot_pnp.el_definitions_value);
-	if (iot_pnp.el_definitions_object == NULL) {
+	for (int i = 0; i < valueCount; ) {
+		i = print_el_value(image, values, i, 0);
+	}
+
+	el_image_close(image);
+	return (status == EL_EDT_OK) ? 0 : -1;
+}
+
+// イメージの定義で値（JSON）をEDTに変換して表示する
+int print_el_encoded(const char *filename, int release, const char *classCode, const char *epc, const char *json)
+{
+	JSON_Value *value = json_parse_string(json);
+	if (value == NULL)
+		return -1;
+
+	const el_image_header *image = el_image_open(filename);
+	if (image == NULL) {
+		json_value_free(value);
 		return -1;
 	}
 
-	el_devices = json_object_get_object(el_root, "devices");
-	if (el_devices == NULL) {
+	uint8_t edt[256];
+	int pdc;
+	el_edt_status status = el_edt_encode(image, (int)strtol(classCode, NULL, 16), (int)strtol(epc, NULL, 16), release,
+		value, edt, sizeof(edt), &pdc);
+	if (status != EL_EDT_OK) {
+		printf("error %d\n", status);
+	}
+	else {
+		for (int i = 0; i < pdc; i++) {
+			printf("%02X", edt[i]);
+		}
+		printf("\n");
+	}
+
+	el_image_close(image);
+	json_value_free(value);
+	return (status == EL_EDT_OK) ? 0 : -1;
+}
+
+// メンバーがcount個のオブジェクトを整形してシリアライズし（サイズを求めてから書き込む）、1メンバーあたりの時間（ナノ秒）を返す
+double benchmark_serialize(int count)
+{
+	JSON_Value *value = json_value_init_object();
+	JSON_Object *object = json_value_get_object(value);
+	char name[32];
+	for (int i = 0; i < count; i++) {
+		sprintf_s(name, "member%d", i);
+		json_object_set_string(object, name, "value");
+	}
+
+	size_t size = json_serialization_size_pretty(value);
+	char *buffer = (char *)malloc(size);
+	if ((size == 0) || (buffer == NULL)) {
+		free(buffer);
+		json_value_free(value);
+		return -1;
+	}
+
+	// 小さいオブジェクトは繰り返して、どの大きさでもメンバー数の合計を同じにする
+	int repeat = (count < 1000000) ? 1000000 / count : 1;
+	LARGE_INTEGER frequency, start, end;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&start);
+	for (int i = 0; i < repeat; i++) {
+		if ((json_serialization_size_pretty(value) != size)
+			|| (json_serialize_to_buffer_pretty(value, buffer, size) != JSONSuccess)) {
+			repeat = -1;
+			break;
+		}
+	}
+	QueryPerformanceCounter(&end);
+
+	free(buffer);
+	json_value_free(value);
+	if (repeat < 0)
+		return -1;
+
+	return (double)(end.QuadPart - start.QuadPart) * 1e9 / frequency.QuadPart / ((double)repeat * count);
+}
+
+// メンバー数を変えてシリアライズの時間を測る。1メンバーあたりの時間が変わらなければ、メンバー数に比例している
+int print_serialize_benchmark()
+{
+	printf("members\tns/member\n");
+	for (int count = 1000; count <= 256000; count *= 4) {
+		double time = benchmark_serialize(count);
+		if (time < 0)
+			return -1;
+		printf("%d\t%.1f\n", count, time);
+	}
+
+	return 0;
+}
+
+// 受信したフレーム（16進数の文字列）のプロパティを順にイメージの定義で変換して表示する
+// リリースを指定しなかったときは、フレームに規格Version情報があればそのリリースを使う
+int print_el_frame(const char *filename, int release, const char *frame_str)
+{
+	const el_image_header *image = el_image_open(filename);
+	if (image == NULL)
+		return -1;
+
+	uint8_t data[1500];
+	int length = read_hex(frame_str, data, sizeof(data));
+
+	el_frame frame;
+	el_frame_status frameStatus = el_frame_parse(data, length, &frame);
+	if (frameStatus != EL_FRAME_OK) {
+		printf("error %d\n", frameStatus);
+		el_image_close(image);
 		return -1;
 	}
 
+	printf("TID %04X SEOJ %06X DEOJ %06X ESV %02X\n", frame.tid, frame.seoj, frame.deoj, frame.esv);
+
+	el_frame_property property;
+	for (el_frame scan = frame; (release == EL_RELEASE_LATEST) && el_frame_next(&scan, &property); ) {
+		release = el_frame_release(&property);
+	}
+	if (release != EL_RELEASE_LATEST) {
+		printf("Release %c\n", release);
+	}
+
+	// 係数はフレームの中のものだけを使う
+	el_frame scan = frame;
+	el_edt_property properties[256];
+	int propertyCount = el_frame_get_properties(&scan, properties, _countof(properties));
+	el_value values[256];
+	int valueCount;
+	el_edt_status status = el_edt_decode_batch(image, el_frame_class_code(el_frame_owner(&frame)), release, properties, propertyCount, NULL, values, _countof(values), &valueCount);
+	int result = (status == EL_EDT_OK) ? 0 : -1;
+
+	for (int i = 0; i < propertyCount; i++) {
+		el_edt_property *item = &properties[i];
+		printf("%s%02X PDC %d\n", (i >= frame.opc) ? "Get " : "", item->epc, item->pdc);
+
+		if (item->status != EL_EDT_OK) {
+			printf("error %d\n", item->status);
+			result = -1;
+		}
+
+		for (int j = item->firstValue; j < item->firstValue + item->valueCount; ) {
+			j = print_el_value(image, values, j, 1);
+		}
+	}
+
+	el_image_close(image);
+	return result;
+}
+
+#define MEM_DEBUG
+
+int main(int argc, char *argv[])
+{
+#ifdef MEM_DEBUG
+	_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
+#endif
+
+	char filename[] = "AppendixData\\EL_DeviceDescription_3_1_5r4.json";
+	iot_pnp iot_pnp;
+	el_reader reader;
+	el_image_builder image;
+
+	memset(&iot_pnp, 0, sizeof(iot_pnp));
+	memset(&reader, 0, sizeof(reader));
+
+	// 引数で変換スレッド数を指定する（0なら読み込みと同じスレッドで変換）。省略時はプロセッサ数
+	// "-c ファイル名"で変換したモデルをイメージにも書き込み、"-i ファイル名"でイメージの内容を表示する
+	// "-d ファイル名 クラスコード EPC EDT"でイメージの定義を使ってEDTを変換する
+	// "-e ファイル名 クラスコード EPC 値（JSON）"でイメージの定義を使って値をEDTに変換する
+	// "-f ファイル名 フレーム"で受信したフレームのプロパティをイメージの定義を使って変換する
+	// "-s"でEnum、Objectなどのスキーマを内容が同じものごとにインターフェースのschemasへまとめ、@idで参照する
+	// "-o ディレクトリ"で、インターフェースごとのファイルと一覧（manifest.json）をディレクトリに書き込む
+	// "-u ファイル名"で、前回の出力をファイルから読み、入力が変わらない機器は変換せずに使う。今回の出力はファイルに書き込む
+	// "-b"で、メンバー数を変えて大きなオブジェクトのシリアライズの時間（1メンバーあたり）を測る
+	// "-r リリース"を前に付けると、そのリリースの定義だけを変換し、-d、-e、-fでもそのリリースの定義を使う
+	SYSTEM_INFO systemInfo;
+	GetSystemInfo(&systemInfo);
+	int threadCount = systemInfo.dwNumberOfProcessors;
+	const char *imageFilename = NULL;
+	const char *shardDirectory = NULL;
+
+	for (int i = 1; i < argc; i++) {
+		// オプションの引数が足りないときはエラー
+		if (strcmp(argv[i], "-c") == 0) {
+			if (i + 1 >= argc)
+				return -1;
+			imageFilename = argv[++i];
+		}
+		else if (strcmp(argv[i], "-o") == 0) {
+			if (i + 1 >= argc)
+				return -1;
+			shardDirectory = argv[++i];
+		}
+		else if (strcmp(argv[i], "-u") == 0) {
+			if (i + 1 >= argc)
+				return -1;
+			iot_pnp.cacheFilename = argv[++i];
+		}
+		else if (strcmp(argv[i], "-s") == 0) {
+			iot_pnp.sharedSchemas = true;
+		}
+		else if (strcmp(argv[i], "-r") == 0) {
+			if (i + 1 >= argc)
+				return -1;
+			iot_pnp.release = argv[++i][0];
+			if ((iot_pnp.release < 'A') || (iot_pnp.release > 'Z'))
+				return -1;
+		}
+		else if (strcmp(argv[i], "-i") == 0) {
+			if (i + 1 >= argc)
+				return -1;
+			return print_el_image(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-d") == 0) {
+			if (i + 4 >= argc)
+				return -1;
+			return print_el_edt(argv[i + 1], iot_pnp.release, argv[i + 2], argv[i + 3], argv[i + 4]);
+		}
+		else if (strcmp(argv[i], "-e") == 0) {
+			if (i + 4 >= argc)
+				return -1;
+			return print_el_encoded(argv[i + 1], iot_pnp.release, argv[i + 2], argv[i + 3], argv[i + 4]);
+		}
+		else if (strcmp(argv[i], "-f") == 0) {
+			if (i + 2 >= argc)
+				return -1;
+			return print_el_frame(argv[i + 1], iot_pnp.release, argv[i + 2]);
+		}
+		else if (strcmp(argv[i], "-b") == 0) {
+			return print_serialize_benchmark();
+		}
+		else {
+			// 数字だけの引数はスレッド数、それ以外は不明なオプション
+			char *end;
+			long count = strtol(argv[i], &end, 10);
+			if ((end == argv[i]) || (*end != '\0') || (count < 0) || (count > INT_MAX))
+				return -1;
+			threadCount = (int)count;
+		}
+	}
+
+	if (imageFilename != NULL) {
+		if (!el_image_builder_init(&image)) {
+			return -1;
+		}
+		iot_pnp.image = &image;
+		threadCount = 0;
+	}
+
+	// 入力と出力のDOMはアリーナに確保し、まとめて解放する。出力は機器ごとのアリーナに作り、最後に並べる
+	iot_pnp.el_arena = json_arena_init();
 	iot_pnp.dt_root_value = json_value_init_array();
 	iot_pnp.dt_root_array = json_value_get_array(iot_pnp.dt_root_value);
 
-	for (int i = 0; i < json_object_get_count(el_devices); i++) {
-		const char *deviceId = json_object_get_name(el_devices, i);
-		JSON_Object *device;
+	if (iot_pnp.cacheFilename != NULL) {
+		load_dt_cache(&iot_pnp);
+	}
 
-		device = json_object_get_object(el_devices, deviceId);
-		if (device == NULL) {
-			DebugBreak();
-			continue;
-		}
+	start_dt_workers(&iot_pnp, threadCount);
+
+	// 付録全体のDOMは作らず、"definitions"の後に続く"devices"を一台ずつ変換する
+	reader.iot_pnp = &iot_pnp;
+	reader.handler.start_object = el_reader_start;
+	reader.handler.end_object = el_reader_end;
+	reader.handler.start_array = el_reader_start;
+	reader.handler.end_array = el_reader_end;
+	reader.handler.key = el_reader_key;
+	reader.handler.value = el_reader_value;
+	JSON_Status status = json_sax_parse_file(filename, &reader.handler, &reader);
+	stop_dt_workers(&iot_pnp);
+	free_dt_cache(&iot_pnp);
+	if (status != JSONSuccess) {
+		return -1;
+	}
 
-		parse_device(&iot_pnp, device);
+	if (iot_pnp.el_definitions_object == NULL) {
+		return -1;
 	}
 
-	json_value_free(el_root_value);
+	free_definition_infos(&iot_pnp);
+	json_arena_free(iot_pnp.el_arena);
 
 	json_set_escape_slashes(0);
-	json_serialize_to_file_pretty(iot_pnp.dt_root_value, "el_iot_pnp.json");
+	bool written = true;
+	if (shardDirectory != NULL) {
+		written = write_dt_shards(&iot_pnp, shardDirectory);
+	}
+	else {
+		merge_dt_tasks(&iot_pnp);
+		if (json_serialize_to_file_pretty(iot_pnp.dt_root_value, "el_iot_pnp.json") != JSONSuccess)
+			written = false;
+	}
+	if (iot_pnp.cacheFilename != NULL) {
+		if (shardDirectory != NULL) {
+			merge_dt_tasks(&iot_pnp);
+		}
+		if (!save_dt_cache(&iot_pnp))
+			written = false;
+	}
 	json_value_free(iot_pnp.dt_root_value);
+	free_dt_tasks(&iot_pnp);
+
+	if (iot_pnp.image != NULL) {
+		bool saved = el_image_save(iot_pnp.image, imageFilename);
+		el_image_builder_free(iot_pnp.image);
+		if (!saved) {
+			return -1;
+		}
+	}
+
+	if (!written) {
+		return -1;
+	}
 
 #ifdef MEM_DEBUG
 	_CrtDumpMemoryLeaks();
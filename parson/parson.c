@@ -37,12 +37,33 @@
 #include <math.h>
 #include <errno.h>
 
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 /* Apparently sscanf is not implemented in some "standard" libraries, so don't use it, if you
  * don't have to. */
 #define sscanf THINK_TWICE_ABOUT_USING_SSCANF
 
 #define STARTING_CAPACITY 16
+#define WRITER_STARTING_CAPACITY 4096
+#define WRITER_CHUNK_SIZE 65536 /* buffer size when serializing straight to a file */
 #define MAX_NESTING       2048
+#define HASH_THRESHOLD    16 /* objects with more names than this get a hash index */
+
+#define ARENA_CHUNK_SIZE     65536   /* size of the first chunk, following ones double up to ARENA_MAX_CHUNK_SIZE */
+#define ARENA_MAX_CHUNK_SIZE 1048576
+#define ARENA_ALIGNMENT      8
+#define ARENA_ALIGN(n)       (((n) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+#define INTERN_MAX_LENGTH    64 /* longer string values are rarely repeated, so they aren't interned (names always are) */
 
 #define FLOAT_FORMAT "%1.17g" /* do not increase precision without incresing NUM_BUF_SIZE */
 #define NUM_BUF_SIZE 64 /* double printed with "%1.17g" shouldn't be longer than 25 bytes so let's be paranoid and use 64 */
@@ -68,6 +89,10 @@ static int parson_escape_slashes = 1;
 
 #define IS_CONT(b) (((unsigned char)(b) & 0xC0) == 0x80) /* is utf-8 continuation byte */
 
+#define VALUE_FLAG_BORROWED 0x1 /* string points into parsed input and isn't freed */
+#define VALUE_FLAG_DOCUMENT 0x2 /* value is root of JSON_Document that owns parsed input */
+#define VALUE_FLAG_ARENA    0x4 /* value and its contents are allocated from an arena */
+
 /* Type definitions */
 typedef union json_value_value {
     char        *string;
@@ -81,15 +106,20 @@ typedef union json_value_value {
 struct json_value_t {
     JSON_Value      *parent;
     JSON_Value_Type  type;
+    int              flags;
     JSON_Value_Value value;
 };
 
 struct json_object_t {
     JSON_Value  *wrapping_value;
     char       **names;
+    size_t      *name_lengths;
     JSON_Value **values;
     size_t       count;
     size_t       capacity;
+    size_t      *cells; /* open addressing hash index, holds item index + 1 (0 is an empty cell) */
+    size_t       cells_capacity; /* power of 2 */
+    JSON_Arena  *arena; /* NULL if allocated with parson_malloc */
 };
 
 struct json_array_t {
@@ -97,10 +127,73 @@ struct json_array_t {
     JSON_Value **items;
     size_t       count;
     size_t       capacity;
+    JSON_Arena  *arena; /* NULL if allocated with parson_malloc */
+};
+
+/* Chunk header, followed by size bytes of memory starting at ARENA_ALIGN(sizeof(JSON_Arena_Chunk)) */
+typedef struct json_arena_chunk_t {
+    struct json_arena_chunk_t *next;
+    size_t size;
+    size_t used;
+} JSON_Arena_Chunk;
+
+typedef struct json_arena_interned_t {
+    const char   *string; /* NULL if cell is empty */
+    size_t        length;
+    unsigned long hash;
+} JSON_Arena_Interned;
+
+typedef struct json_arena_mapping_t {
+    struct json_arena_mapping_t *next;
+    char   *mapping;
+    size_t  mapping_size;
+} JSON_Arena_Mapping;
+
+struct json_arena_t {
+    JSON_Arena_Chunk   *chunks; /* chunk being filled is first */
+    size_t              next_chunk_size;
+    JSON_Arena_Mapping *mappings; /* parsed files, allocated from arena itself */
+    JSON_Arena_Interned *interned; /* open addressing set of strings shared by names and values, allocated with parson_malloc */
+    size_t              interned_count;
+    size_t              interned_capacity; /* power of 2 */
 };
 
+/* Root value of a parsed memory mapped file */
+typedef struct json_document_t {
+    JSON_Value  value; /* must be first */
+    char       *mapping;
+    size_t      mapping_size;
+} JSON_Document;
+
+/* Parser state */
+typedef struct json_parser_t {
+    int borrow_strings; /* input is writable and outlives parsed values, so strings without escapes can point into it */
+    JSON_Arena *arena;  /* NULL if values are allocated with parson_malloc */
+} JSON_Parser;
+
+/* Event driven parser state */
+typedef struct json_sax_parser_t {
+    JSON_Parser       parser; /* used for strings passed to callbacks */
+    JSON_Sax_Handler *handler;
+    void             *context;
+} JSON_Sax_Parser;
+
+/* Output of single pass serialization. Without fp buffer grows to hold whole output,
+   with fp it is a fixed size chunk that is flushed to the file whenever it fills up.
+   With is_fixed it is the caller's buffer and running out of it is a failure,
+   a fixed writer without buf only counts the output length. */
+typedef struct json_writer_t {
+    char   *buf;
+    size_t  len;
+    size_t  capacity;
+    FILE   *fp;
+    int     is_fixed;
+} JSON_Writer;
+
 /* Various */
 static char * read_file(const char *filename);
+static char * map_file(const char *filename, size_t *mapping_size);
+static void   unmap_file(char *mapping, size_t mapping_size);
 static void   remove_comments(char *string, const char *start_token, const char *end_token);
 static char * parson_strndup(const char *string, size_t n);
 static char * parson_strdup(const char *string);
@@ -110,44 +203,76 @@ static int    num_bytes_in_utf8_sequence(unsigned char c);
 static int    verify_utf8_sequence(const unsigned char *string, int *len);
 static int    is_valid_utf8(const char *string, size_t string_len);
 static int    is_decimal(const char *string, size_t length);
+static unsigned long hash_string(const char *string, size_t n);
+
+/* Arena */
+static void * arena_malloc(JSON_Arena *arena, size_t size);
+static void   arena_free(JSON_Arena *arena, void *ptr);
+static char * arena_strndup(JSON_Arena *arena, const char *string, size_t n);
+static const char * arena_intern(JSON_Arena *arena, const char *string, size_t n, int copy);
+static JSON_Status  arena_intern_grow(JSON_Arena *arena);
+static int    arena_accepts(const JSON_Arena *arena, const JSON_Value *value);
 
 /* JSON Object */
-static JSON_Object * json_object_init(JSON_Value *wrapping_value);
+static JSON_Object * json_object_init(JSON_Value *wrapping_value, JSON_Arena *arena);
+static JSON_Arena  * json_object_get_arena(const JSON_Object *object);
 static JSON_Status   json_object_add(JSON_Object *object, const char *name, JSON_Value *value);
 static JSON_Status   json_object_addn(JSON_Object *object, const char *name, size_t name_len, JSON_Value *value);
 static JSON_Status   json_object_resize(JSON_Object *object, size_t new_capacity);
+static JSON_Status   json_object_rehash(JSON_Object *object, size_t new_cells_capacity);
+static void          json_object_hash_insert(JSON_Object *object, size_t index);
+static size_t        json_object_hash_find_cell(const JSON_Object *object, size_t index);
+static void          json_object_hash_remove(JSON_Object *object, size_t index, size_t last_index);
+static void          json_object_update_index(JSON_Object *object);
+static size_t        json_object_getn_index(const JSON_Object *object, const char *name, size_t name_len);
 static JSON_Value  * json_object_getn_value(const JSON_Object *object, const char *name, size_t name_len);
 static JSON_Status   json_object_remove_internal(JSON_Object *object, const char *name, int free_value);
 static JSON_Status   json_object_dotremove_internal(JSON_Object *object, const char *name, int free_value);
 static void          json_object_free(JSON_Object *object);
 
 /* JSON Array */
-static JSON_Array * json_array_init(JSON_Value *wrapping_value);
+static JSON_Array * json_array_init(JSON_Value *wrapping_value, JSON_Arena *arena);
+static JSON_Arena * json_array_get_arena(const JSON_Array *array);
 static JSON_Status  json_array_add(JSON_Array *array, JSON_Value *value);
 static JSON_Status  json_array_resize(JSON_Array *array, size_t new_capacity);
 static void         json_array_free(JSON_Array *array);
 
 /* JSON Value */
-static JSON_Value * json_value_init_string_no_copy(char *string);
+static JSON_Value * json_value_init_string_no_copy(JSON_Arena *arena, char *string);
+static JSON_Value * json_value_init_document(JSON_Value *root, char *mapping, size_t mapping_size);
 
 /* Parser */
 static JSON_Status  skip_quotes(const char **string);
 static int          parse_utf16(const char **unprocessed, char **processed);
-static char *       process_string(const char *input, size_t len);
-static char *       get_quoted_string(const char **string);
-static JSON_Value * parse_object_value(const char **string, size_t nesting);
-static JSON_Value * parse_array_value(const char **string, size_t nesting);
-static JSON_Value * parse_string_value(const char **string);
-static JSON_Value * parse_boolean_value(const char **string);
-static JSON_Value * parse_number_value(const char **string);
-static JSON_Value * parse_null_value(const char **string);
-static JSON_Value * parse_value(const char **string, size_t nesting);
+static char *       process_string(JSON_Arena *arena, const char *input, size_t len);
+static int          is_plain_string(const char *string, size_t len);
+static char *       get_quoted_string(JSON_Parser *parser, const char **string, int *is_borrowed);
+static JSON_Value * parse_object_value(JSON_Parser *parser, const char **string, size_t nesting);
+static JSON_Value * parse_array_value(JSON_Parser *parser, const char **string, size_t nesting);
+static JSON_Value * parse_string_value(JSON_Parser *parser, const char **string);
+static JSON_Value * parse_boolean_value(JSON_Parser *parser, const char **string);
+static JSON_Value * parse_number_value(JSON_Parser *parser, const char **string);
+static JSON_Value * parse_null_value(JSON_Parser *parser, const char **string);
+static JSON_Value * parse_value(JSON_Parser *parser, const char **string, size_t nesting);
+
+/* Event driven parser */
+static JSON_Status  sax_parse_value(JSON_Sax_Parser *sax, const char **string, size_t nesting, int build);
+static JSON_Status  sax_parse_object(JSON_Sax_Parser *sax, const char **string, size_t nesting);
+static JSON_Status  sax_parse_array(JSON_Sax_Parser *sax, const char **string, size_t nesting);
+static JSON_Status  sax_parse_string(JSON_Sax_Parser *sax, const char **string);
+static JSON_Status  sax_parse_literal(JSON_Sax_Parser *sax, const char **string);
 
 /* Serialization */
-static int    json_serialize_to_buffer_r(const JSON_Value *value, char *buf, int level, int is_pretty, char *num_buf);
-static int    json_serialize_string(const char *string, char *buf);
-static int    append_indent(char *buf, int level);
-static int    append_string(char *buf, const char *string);
+static JSON_Status writer_append(JSON_Writer *writer, const char *data, size_t len);
+static JSON_Status writer_append_indent(JSON_Writer *writer, int level);
+static JSON_Status writer_append_number(JSON_Writer *writer, double number);
+static JSON_Status json_serialize_to_writer_r(const JSON_Value *value, JSON_Writer *writer, int level, int is_pretty);
+static JSON_Status json_serialize_string_to_writer(const char *string, JSON_Writer *writer);
+static char *      json_serialize_to_string_internal(const JSON_Value *value, int is_pretty);
+static JSON_Status writer_flush(JSON_Writer *writer);
+static JSON_Status json_serialize_to_file_internal(const JSON_Value *value, const char *filename, int is_pretty);
+static size_t      json_serialization_size_internal(const JSON_Value *value, int is_pretty);
+static JSON_Status json_serialize_to_buffer_internal(const JSON_Value *value, char *buf, size_t buf_size_in_bytes, int is_pretty);
 
 /* Various */
 static char * parson_strndup(const char *string, size_t n) {
@@ -275,6 +400,20 @@ static int is_decimal(const char *string, size_t length) {
     return 1;
 }
 
+static unsigned long hash_string(const char *string, size_t n) {
+    unsigned long hash = 5381;
+    unsigned char c;
+    size_t i = 0;
+    for (i = 0; i < n; i++) {
+        c = string[i];
+        if (c == '\0') {
+            break;
+        }
+        hash = ((hash << 5) + hash) + c; /* hash * 33 + c */
+    }
+    return hash;
+}
+
 static char * read_file(const char * filename) {
     FILE *fp = fopen(filename, "r");
     size_t size_to_read = 0;
@@ -308,6 +447,69 @@ static char * read_file(const char * filename) {
     return file_contents;
 }
 
+/* Maps file copy-on-write, so the file itself is never modified. Returns NULL when file can't be mapped
+   or when its size is a multiple of page size, since then there is no zero after the last byte. */
+static char * map_file(const char *filename, size_t *mapping_size) {
+#if defined(_WIN32)
+    HANDLE file = INVALID_HANDLE_VALUE, mapping = NULL;
+    LARGE_INTEGER size;
+    SYSTEM_INFO system_info;
+    char *view = NULL;
+    file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return NULL;
+    }
+    GetSystemInfo(&system_info);
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0 || (size_t)size.QuadPart != size.QuadPart ||
+        size.QuadPart % system_info.dwPageSize == 0) {
+        CloseHandle(file);
+        return NULL;
+    }
+    mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL) {
+        return NULL;
+    }
+    view = (char*)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    CloseHandle(mapping); /* view keeps mapping alive */
+    if (view == NULL) {
+        return NULL;
+    }
+    *mapping_size = (size_t)size.QuadPart;
+    return view;
+#else
+    int fd = -1;
+    struct stat st;
+    long page_size = sysconf(_SC_PAGESIZE);
+    void *view = NULL;
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size <= 0 || (size_t)st.st_size != (unsigned long long)st.st_size ||
+        page_size <= 0 || st.st_size % page_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    view = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd); /* mapping stays valid */
+    if (view == MAP_FAILED) {
+        return NULL;
+    }
+    *mapping_size = (size_t)st.st_size;
+    return (char*)view;
+#endif
+}
+
+static void unmap_file(char *mapping, size_t mapping_size) {
+#if defined(_WIN32)
+    (void)mapping_size;
+    UnmapViewOfFile(mapping);
+#else
+    munmap(mapping, mapping_size);
+#endif
+}
+
 static void remove_comments(char *string, const char *start_token, const char *end_token) {
     int in_string = 0, escaped = 0;
     size_t i;
@@ -343,20 +545,154 @@ static void remove_comments(char *string, const char *start_token, const char *e
     }
 }
 
+/* Arena */
+static void * arena_malloc(JSON_Arena *arena, size_t size) {
+    JSON_Arena_Chunk *chunk = NULL;
+    size_t chunk_size = 0;
+    char *ptr = NULL;
+    if (arena == NULL) {
+        return parson_malloc(size);
+    }
+    size = ARENA_ALIGN(size);
+    chunk = arena->chunks;
+    if (chunk == NULL || chunk->size - chunk->used < size) {
+        chunk_size = MAX(arena->next_chunk_size, size);
+        chunk = (JSON_Arena_Chunk*)parson_malloc(ARENA_ALIGN(sizeof(JSON_Arena_Chunk)) + chunk_size);
+        if (chunk == NULL) {
+            return NULL;
+        }
+        chunk->size = chunk_size;
+        chunk->used = 0;
+        if (chunk_size > arena->next_chunk_size && arena->chunks != NULL) {
+            /* oversized allocation gets its own chunk, keep filling the current one */
+            chunk->next = arena->chunks->next;
+            arena->chunks->next = chunk;
+        } else {
+            chunk->next = arena->chunks;
+            arena->chunks = chunk;
+            if (arena->next_chunk_size < ARENA_MAX_CHUNK_SIZE) {
+                arena->next_chunk_size *= 2;
+            }
+        }
+    }
+    ptr = (char*)chunk + ARENA_ALIGN(sizeof(JSON_Arena_Chunk)) + chunk->used;
+    chunk->used += size;
+    return ptr;
+}
+
+static void arena_free(JSON_Arena *arena, void *ptr) {
+    if (arena == NULL) {
+        parson_free(ptr);
+    }
+    /* arena memory is released only with the whole arena */
+}
+
+static char * arena_strndup(JSON_Arena *arena, const char *string, size_t n) {
+    char *output_string = (char*)arena_malloc(arena, n + 1);
+    if (!output_string) {
+        return NULL;
+    }
+    output_string[n] = '\0';
+    memcpy(output_string, string, n);
+    return output_string;
+}
+
+/* Returns shared copy of string, so repeated names and values take memory once.
+   Without copy string must already live as long as arena (in its memory or mapping). */
+static const char * arena_intern(JSON_Arena *arena, const char *string, size_t n, int copy) {
+    size_t mask = 0, cell_ix = 0;
+    unsigned long hash = hash_string(string, n);
+    JSON_Arena_Interned *cell = NULL;
+    const char *output_string = NULL;
+    if (arena->interned_count * 2 >= arena->interned_capacity && arena_intern_grow(arena) == JSONFailure) {
+        return copy ? arena_strndup(arena, string, n) : string; /* works without sharing */
+    }
+    mask = arena->interned_capacity - 1;
+    cell_ix = hash & mask;
+    while (arena->interned[cell_ix].string != NULL) {
+        cell = &arena->interned[cell_ix];
+        if (cell->hash == hash && cell->length == n && memcmp(cell->string, string, n) == 0) {
+            return cell->string;
+        }
+        cell_ix = (cell_ix + 1) & mask;
+    }
+    output_string = copy ? arena_strndup(arena, string, n) : string;
+    if (output_string == NULL) {
+        return NULL;
+    }
+    cell = &arena->interned[cell_ix];
+    cell->string = output_string;
+    cell->length = n;
+    cell->hash = hash;
+    arena->interned_count++;
+    return output_string;
+}
+
+static JSON_Status arena_intern_grow(JSON_Arena *arena) {
+    size_t i = 0, cell_ix = 0;
+    size_t new_capacity = arena->interned_capacity ? arena->interned_capacity * 2 : STARTING_CAPACITY * 16;
+    JSON_Arena_Interned *new_interned = (JSON_Arena_Interned*)parson_malloc(new_capacity * sizeof(JSON_Arena_Interned));
+    if (new_interned == NULL) {
+        return JSONFailure;
+    }
+    memset(new_interned, 0, new_capacity * sizeof(JSON_Arena_Interned));
+    for (i = 0; i < arena->interned_capacity; i++) {
+        if (arena->interned[i].string == NULL) {
+            continue;
+        }
+        cell_ix = arena->interned[i].hash & (new_capacity - 1);
+        while (new_interned[cell_ix].string != NULL) {
+            cell_ix = (cell_ix + 1) & (new_capacity - 1);
+        }
+        new_interned[cell_ix] = arena->interned[i];
+    }
+    parson_free(arena->interned);
+    arena->interned = new_interned;
+    arena->interned_capacity = new_capacity;
+    return JSONSuccess;
+}
+
+/* Containers from an arena only hold values from the same arena, so freeing never has to walk them */
+static int arena_accepts(const JSON_Arena *arena, const JSON_Value *value) {
+    const JSON_Arena_Chunk *chunk = NULL;
+    const char *start = NULL;
+    if (arena == NULL) {
+        return 1;
+    }
+    if (!(value->flags & VALUE_FLAG_ARENA)) {
+        return 0;
+    }
+    for (chunk = arena->chunks; chunk != NULL; chunk = chunk->next) {
+        start = (const char*)chunk + ARENA_ALIGN(sizeof(JSON_Arena_Chunk));
+        if ((const char*)value >= start && (const char*)value < start + chunk->used) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
 /* JSON Object */
-static JSON_Object * json_object_init(JSON_Value *wrapping_value) {
-    JSON_Object *new_obj = (JSON_Object*)parson_malloc(sizeof(JSON_Object));
+static JSON_Object * json_object_init(JSON_Value *wrapping_value, JSON_Arena *arena) {
+    JSON_Object *new_obj = (JSON_Object*)arena_malloc(arena, sizeof(JSON_Object));
     if (new_obj == NULL) {
         return NULL;
     }
     new_obj->wrapping_value = wrapping_value;
     new_obj->names = (char**)NULL;
+    new_obj->name_lengths = (size_t*)NULL;
     new_obj->values = (JSON_Value**)NULL;
     new_obj->capacity = 0;
     new_obj->count = 0;
+    new_obj->cells = (size_t*)NULL;
+    new_obj->cells_capacity = 0;
+    new_obj->arena = arena;
     return new_obj;
 }
 
+static JSON_Arena * json_object_get_arena(const JSON_Object *object) {
+    return object ? object->arena : NULL;
+}
+
 static JSON_Status json_object_add(JSON_Object *object, const char *name, JSON_Value *value) {
     if (name == NULL) {
         return JSONFailure;
@@ -379,18 +715,29 @@ static JSON_Status json_object_addn(JSON_Object *object, const char *name, size_
         }
     }
     index = object->count;
-    object->names[index] = parson_strndup(name, name_len);
+    if (object->arena != NULL) {
+        object->names[index] = (char*)arena_intern(object->arena, name, name_len, 1);
+    } else {
+        object->names[index] = parson_strndup(name, name_len);
+    }
     if (object->names[index] == NULL) {
         return JSONFailure;
     }
+    object->name_lengths[index] = strlen(object->names[index]);
     value->parent = json_object_get_wrapping_value(object);
     object->values[index] = value;
     object->count++;
+    if (object->cells != NULL && object->count * 2 <= object->cells_capacity) {
+        json_object_hash_insert(object, index);
+    } else if (object->count > HASH_THRESHOLD) {
+        json_object_rehash(object, object->cells_capacity ? object->cells_capacity * 2 : STARTING_CAPACITY * 4);
+    }
     return JSONSuccess;
 }
 
 static JSON_Status json_object_resize(JSON_Object *object, size_t new_capacity) {
     char **temp_names = NULL;
+    size_t *temp_name_lengths = NULL;
     JSON_Value **temp_values = NULL;
 
     if ((object->names == NULL && object->values != NULL) ||
@@ -398,62 +745,174 @@ static JSON_Status json_object_resize(JSON_Object *object, size_t new_capacity)
         new_capacity == 0) {
             return JSONFailure; /* Shouldn't happen */
     }
-    temp_names = (char**)parson_malloc(new_capacity * sizeof(char*));
+    temp_names = (char**)arena_malloc(object->arena, new_capacity * sizeof(char*));
     if (temp_names == NULL) {
         return JSONFailure;
     }
-    temp_values = (JSON_Value**)parson_malloc(new_capacity * sizeof(JSON_Value*));
+    temp_name_lengths = (size_t*)arena_malloc(object->arena, new_capacity * sizeof(size_t));
+    if (temp_name_lengths == NULL) {
+        arena_free(object->arena, temp_names);
+        return JSONFailure;
+    }
+    temp_values = (JSON_Value**)arena_malloc(object->arena, new_capacity * sizeof(JSON_Value*));
     if (temp_values == NULL) {
-        parson_free(temp_names);
+        arena_free(object->arena, temp_names);
+        arena_free(object->arena, temp_name_lengths);
         return JSONFailure;
     }
     if (object->names != NULL && object->values != NULL && object->count > 0) {
         memcpy(temp_names, object->names, object->count * sizeof(char*));
+        memcpy(temp_name_lengths, object->name_lengths, object->count * sizeof(size_t));
         memcpy(temp_values, object->values, object->count * sizeof(JSON_Value*));
     }
-    parson_free(object->names);
-    parson_free(object->values);
+    arena_free(object->arena, object->names);
+    arena_free(object->arena, object->name_lengths);
+    arena_free(object->arena, object->values);
     object->names = temp_names;
+    object->name_lengths = temp_name_lengths;
     object->values = temp_values;
     object->capacity = new_capacity;
     return JSONSuccess;
 }
 
-static JSON_Value * json_object_getn_value(const JSON_Object *object, const char *name, size_t name_len) {
-    size_t i, name_length;
-    for (i = 0; i < json_object_get_count(object); i++) {
-        name_length = strlen(object->names[i]);
-        if (name_length != name_len) {
+/* Builds hash index from scratch. On failure object is left without index and lookups fall back to linear search. */
+static JSON_Status json_object_rehash(JSON_Object *object, size_t new_cells_capacity) {
+    size_t i = 0;
+    arena_free(object->arena, object->cells);
+    object->cells = (size_t*)NULL;
+    object->cells_capacity = 0;
+    while (new_cells_capacity < object->count * 2) {
+        new_cells_capacity *= 2;
+    }
+    object->cells = (size_t*)arena_malloc(object->arena, new_cells_capacity * sizeof(size_t));
+    if (object->cells == NULL) {
+        return JSONFailure;
+    }
+    memset(object->cells, 0, new_cells_capacity * sizeof(size_t));
+    object->cells_capacity = new_cells_capacity;
+    for (i = 0; i < object->count; i++) {
+        json_object_hash_insert(object, i);
+    }
+    return JSONSuccess;
+}
+
+static void json_object_hash_insert(JSON_Object *object, size_t index) {
+    size_t mask = object->cells_capacity - 1;
+    size_t cell_ix = hash_string(object->names[index], object->name_lengths[index]) & mask;
+    while (object->cells[cell_ix] != 0) {
+        cell_ix = (cell_ix + 1) & mask;
+    }
+    object->cells[cell_ix] = index + 1;
+}
+
+static size_t json_object_hash_find_cell(const JSON_Object *object, size_t index) {
+    size_t mask = object->cells_capacity - 1;
+    size_t cell_ix = hash_string(object->names[index], object->name_lengths[index]) & mask;
+    while (object->cells[cell_ix] != index + 1) {
+        cell_ix = (cell_ix + 1) & mask;
+    }
+    return cell_ix;
+}
+
+/* Removes names[index] from the index before the item from last_index is moved in its place.
+   Following cells of the probe run are shifted back, so lookups never stop at the freed cell. */
+static void json_object_hash_remove(JSON_Object *object, size_t index, size_t last_index) {
+    size_t mask = object->cells_capacity - 1;
+    size_t cell_ix = json_object_hash_find_cell(object, index);
+    size_t next_ix = cell_ix, home_ix = 0, item_ix = 0;
+    for (;;) {
+        next_ix = (next_ix + 1) & mask;
+        if (object->cells[next_ix] == 0) {
+            break;
+        }
+        item_ix = object->cells[next_ix] - 1;
+        home_ix = hash_string(object->names[item_ix], object->name_lengths[item_ix]) & mask;
+        if (((next_ix - home_ix) & mask) >= ((next_ix - cell_ix) & mask)) {
+            object->cells[cell_ix] = object->cells[next_ix];
+            cell_ix = next_ix;
+        }
+    }
+    object->cells[cell_ix] = 0;
+    if (index != last_index) {
+        object->cells[json_object_hash_find_cell(object, last_index)] = index + 1;
+    }
+}
+
+/* Called after names were cleared or reordered */
+static void json_object_update_index(JSON_Object *object) {
+    if (object->count > HASH_THRESHOLD) {
+        json_object_rehash(object, object->cells_capacity ? object->cells_capacity : STARTING_CAPACITY * 4);
+    } else {
+        arena_free(object->arena, object->cells);
+        object->cells = (size_t*)NULL;
+        object->cells_capacity = 0;
+    }
+}
+
+static size_t json_object_getn_index(const JSON_Object *object, const char *name, size_t name_len) {
+    size_t i, mask, cell_ix;
+    if (object == NULL) {
+        return (size_t)-1;
+    }
+    if (object->cells != NULL) {
+        mask = object->cells_capacity - 1;
+        cell_ix = hash_string(name, name_len) & mask;
+        while ((i = object->cells[cell_ix]) != 0) {
+            i -= 1;
+            if (object->name_lengths[i] == name_len &&
+                (object->names[i] == name || strncmp(object->names[i], name, name_len) == 0)) {
+                return i;
+            }
+            cell_ix = (cell_ix + 1) & mask;
+        }
+        return (size_t)-1;
+    }
+    for (i = 0; i < object->count; i++) {
+        if (object->name_lengths[i] != name_len) {
             continue;
         }
-        if (strncmp(object->names[i], name, name_len) == 0) {
-            return object->values[i];
+        if (object->names[i] == name || strncmp(object->names[i], name, name_len) == 0) {
+            return i;
         }
     }
-    return NULL;
+    return (size_t)-1;
+}
+
+static JSON_Value * json_object_getn_value(const JSON_Object *object, const char *name, size_t name_len) {
+    size_t i = json_object_getn_index(object, name, name_len);
+    if (i == (size_t)-1) {
+        return NULL;
+    }
+    return object->values[i];
 }
 
 static JSON_Status json_object_remove_internal(JSON_Object *object, const char *name, int free_value) {
     size_t i = 0, last_item_index = 0;
-    if (object == NULL || json_object_get_value(object, name) == NULL) {
+    if (object == NULL || name == NULL) {
+        return JSONFailure;
+    }
+    i = json_object_getn_index(object, name, strlen(name));
+    if (i == (size_t)-1) {
         return JSONFailure;
     }
     last_item_index = json_object_get_count(object) - 1;
-    for (i = 0; i < json_object_get_count(object); i++) {
-        if (strcmp(object->names[i], name) == 0) {
-            parson_free(object->names[i]);
-            if (free_value) {
-                json_value_free(object->values[i]);
-            }
-            if (i != last_item_index) { /* Replace key value pair with one from the end */
-                object->names[i] = object->names[last_item_index];
-                object->values[i] = object->values[last_item_index];
-            }
-            object->count -= 1;
-            return JSONSuccess;
-        }
+    if (object->cells != NULL) {
+        json_object_hash_remove(object, i, last_item_index);
+    }
+    arena_free(object->arena, object->names[i]);
+    if (free_value) {
+        json_value_free(object->values[i]);
+    }
+    if (i != last_item_index) { /* Replace key value pair with one from the end */
+        object->names[i] = object->names[last_item_index];
+        object->name_lengths[i] = object->name_lengths[last_item_index];
+        object->values[i] = object->values[last_item_index];
     }
-    return JSONFailure; /* No execution path should end here */
+    object->count -= 1;
+    if (object->cells == NULL || object->count <= HASH_THRESHOLD) {
+        json_object_update_index(object);
+    }
+    return JSONSuccess;
 }
 
 static JSON_Status json_object_dotremove_internal(JSON_Object *object, const char *name, int free_value) {
@@ -474,17 +933,19 @@ static JSON_Status json_object_dotremove_internal(JSON_Object *object, const cha
 static void json_object_free(JSON_Object *object) {
     size_t i;
     for (i = 0; i < object->count; i++) {
-        parson_free(object->names[i]);
+        arena_free(object->arena, object->names[i]);
         json_value_free(object->values[i]);
     }
-    parson_free(object->names);
-    parson_free(object->values);
-    parson_free(object);
+    arena_free(object->arena, object->names);
+    arena_free(object->arena, object->name_lengths);
+    arena_free(object->arena, object->values);
+    arena_free(object->arena, object->cells);
+    arena_free(object->arena, object);
 }
 
 /* JSON Array */
-static JSON_Array * json_array_init(JSON_Value *wrapping_value) {
-    JSON_Array *new_array = (JSON_Array*)parson_malloc(sizeof(JSON_Array));
+static JSON_Array * json_array_init(JSON_Value *wrapping_value, JSON_Arena *arena) {
+    JSON_Array *new_array = (JSON_Array*)arena_malloc(arena, sizeof(JSON_Array));
     if (new_array == NULL) {
         return NULL;
     }
@@ -492,9 +953,14 @@ static JSON_Array * json_array_init(JSON_Value *wrapping_value) {
     new_array->items = (JSON_Value**)NULL;
     new_array->capacity = 0;
     new_array->count = 0;
+    new_array->arena = arena;
     return new_array;
 }
 
+static JSON_Arena * json_array_get_arena(const JSON_Array *array) {
+    return array ? array->arena : NULL;
+}
+
 static JSON_Status json_array_add(JSON_Array *array, JSON_Value *value) {
     if (array->count >= array->capacity) {
         size_t new_capacity = MAX(array->capacity * 2, STARTING_CAPACITY);
@@ -513,14 +979,14 @@ static JSON_Status json_array_resize(JSON_Array *array, size_t new_capacity) {
     if (new_capacity == 0) {
         return JSONFailure;
     }
-    new_items = (JSON_Value**)parson_malloc(new_capacity * sizeof(JSON_Value*));
+    new_items = (JSON_Value**)arena_malloc(array->arena, new_capacity * sizeof(JSON_Value*));
     if (new_items == NULL) {
         return JSONFailure;
     }
     if (array->items != NULL && array->count > 0) {
         memcpy(new_items, array->items, array->count * sizeof(JSON_Value*));
     }
-    parson_free(array->items);
+    arena_free(array->arena, array->items);
     array->items = new_items;
     array->capacity = new_capacity;
     return JSONSuccess;
@@ -531,22 +997,58 @@ static void json_array_free(JSON_Array *array) {
     for (i = 0; i < array->count; i++) {
         json_value_free(array->items[i]);
     }
-    parson_free(array->items);
-    parson_free(array);
+    arena_free(array->arena, array->items);
+    arena_free(array->arena, array);
 }
 
 /* JSON Value */
-static JSON_Value * json_value_init_string_no_copy(char *string) {
-    JSON_Value *new_value = (JSON_Value*)parson_malloc(sizeof(JSON_Value));
+static JSON_Value * json_value_init_string_no_copy(JSON_Arena *arena, char *string) {
+    JSON_Value *new_value = (JSON_Value*)arena_malloc(arena, sizeof(JSON_Value));
     if (!new_value) {
         return NULL;
     }
     new_value->parent = NULL;
     new_value->type = JSONString;
+    new_value->flags = arena ? VALUE_FLAG_ARENA : 0;
     new_value->value.string = string;
     return new_value;
 }
 
+/* Moves root into a JSON_Document that releases mapping when freed */
+static JSON_Value * json_value_init_document(JSON_Value *root, char *mapping, size_t mapping_size) {
+    size_t i = 0;
+    JSON_Object *object = NULL;
+    JSON_Array *array = NULL;
+    JSON_Document *document = (JSON_Document*)parson_malloc(sizeof(JSON_Document));
+    if (document == NULL) {
+        return NULL;
+    }
+    document->value = *root;
+    document->value.flags |= VALUE_FLAG_DOCUMENT;
+    document->mapping = mapping;
+    document->mapping_size = mapping_size;
+    switch (json_value_get_type(root)) {
+        case JSONObject:
+            object = document->value.value.object;
+            object->wrapping_value = &document->value;
+            for (i = 0; i < object->count; i++) {
+                object->values[i]->parent = &document->value;
+            }
+            break;
+        case JSONArray:
+            array = document->value.value.array;
+            array->wrapping_value = &document->value;
+            for (i = 0; i < array->count; i++) {
+                array->items[i]->parent = &document->value;
+            }
+            break;
+        default:
+            break;
+    }
+    parson_free(root);
+    return &document->value;
+}
+
 /* Parser */
 static JSON_Status skip_quotes(const char **string) {
     if (**string != '\"') {
@@ -617,12 +1119,12 @@ static int parse_utf16(const char **unprocessed, char **processed) {
 
 /* Copies and processes passed string up to supplied length.
 Example: "\u006Corem ipsum" -> lorem ipsum */
-static char* process_string(const char *input, size_t len) {
+static char* process_string(JSON_Arena *arena, const char *input, size_t len) {
     const char *input_ptr = input;
     size_t initial_size = (len + 1) * sizeof(char);
     size_t final_size = 0;
     char *output = NULL, *output_ptr = NULL, *resized_output = NULL;
-    output = (char*)parson_malloc(initial_size);
+    output = (char*)arena_malloc(arena, initial_size);
     if (output == NULL) {
         goto error;
     }
@@ -656,6 +1158,9 @@ static char* process_string(const char *input, size_t len) {
         input_ptr++;
     }
     *output_ptr = '\0';
+    if (arena != NULL) {
+        return output; /* arena memory can't be given back anyway */
+    }
     /* resize to new length */
     final_size = (size_t)(output_ptr-output) + 1;
     /* todo: don't resize if final_size == initial_size */
@@ -667,53 +1172,74 @@ static char* process_string(const char *input, size_t len) {
     parson_free(output);
     return resized_output;
 error:
-    parson_free(output);
+    arena_free(arena, output);
     return NULL;
 }
 
+/* Checks if string can be used as is, without process_string */
+static int is_plain_string(const char *string, size_t len) {
+    size_t i;
+    for (i = 0; i < len; i++) {
+        if (string[i] == '\\' || (unsigned char)string[i] < 0x20) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
 /* Return processed contents of a string between quotes and
-   skips passed argument to a matching quote. */
-static char * get_quoted_string(const char **string) {
+   skips passed argument to a matching quote.
+   If is_borrowed is set, returned string points into input and mustn't be freed. */
+static char * get_quoted_string(JSON_Parser *parser, const char **string, int *is_borrowed) {
     const char *string_start = *string;
     size_t string_len = 0;
+    char *borrowed_string = NULL;
     JSON_Status status = skip_quotes(string);
+    *is_borrowed = 0;
     if (status != JSONSuccess) {
         return NULL;
     }
     string_len = *string - string_start - 2; /* length without quotes */
-    return process_string(string_start + 1, string_len);
+    if (parser->borrow_strings && is_plain_string(string_start + 1, string_len)) {
+        borrowed_string = (char*)string_start + 1;
+        borrowed_string[string_len] = '\0'; /* replaces closing quote, which was already skipped */
+        *is_borrowed = 1;
+        return borrowed_string;
+    }
+    return process_string(parser->arena, string_start + 1, string_len);
 }
 
-static JSON_Value * parse_value(const char **string, size_t nesting) {
+static JSON_Value * parse_value(JSON_Parser *parser, const char **string, size_t nesting) {
     if (nesting > MAX_NESTING) {
         return NULL;
     }
     SKIP_WHITESPACES(string);
     switch (**string) {
         case '{':
-            return parse_object_value(string, nesting + 1);
+            return parse_object_value(parser, string, nesting + 1);
         case '[':
-            return parse_array_value(string, nesting + 1);
+            return parse_array_value(parser, string, nesting + 1);
         case '\"':
-            return parse_string_value(string);
+            return parse_string_value(parser, string);
         case 'f': case 't':
-            return parse_boolean_value(string);
+            return parse_boolean_value(parser, string);
         case '-':
         case '0': case '1': case '2': case '3': case '4':
         case '5': case '6': case '7': case '8': case '9':
-            return parse_number_value(string);
+            return parse_number_value(parser, string);
         case 'n':
-            return parse_null_value(string);
+            return parse_null_value(parser, string);
         default:
             return NULL;
     }
 }
 
-static JSON_Value * parse_object_value(const char **string, size_t nesting) {
+static JSON_Value * parse_object_value(JSON_Parser *parser, const char **string, size_t nesting) {
     JSON_Value *output_value = NULL, *new_value = NULL;
     JSON_Object *output_object = NULL;
     char *new_key = NULL;
-    output_value = json_value_init_object();
+    int key_borrowed = 0;
+    output_value = json_value_init_object_arena(parser->arena);
     if (output_value == NULL) {
         return NULL;
     }
@@ -729,31 +1255,39 @@ static JSON_Value * parse_object_value(const char **string, size_t nesting) {
         return output_value;
     }
     while (**string != '\0') {
-        new_key = get_quoted_string(string);
+        new_key = get_quoted_string(parser, string, &key_borrowed);
         if (new_key == NULL) {
             json_value_free(output_value);
             return NULL;
         }
         SKIP_WHITESPACES(string);
         if (**string != ':') {
-            parson_free(new_key);
+            if (!key_borrowed) {
+                arena_free(parser->arena, new_key);
+            }
             json_value_free(output_value);
             return NULL;
         }
         SKIP_CHAR(string);
-        new_value = parse_value(string, nesting);
+        new_value = parse_value(parser, string, nesting);
         if (new_value == NULL) {
-            parson_free(new_key);
+            if (!key_borrowed) {
+                arena_free(parser->arena, new_key);
+            }
             json_value_free(output_value);
             return NULL;
         }
         if (json_object_add(output_object, new_key, new_value) == JSONFailure) {
-            parson_free(new_key);
+            if (!key_borrowed) {
+                arena_free(parser->arena, new_key);
+            }
             json_value_free(new_value);
             json_value_free(output_value);
             return NULL;
         }
-        parson_free(new_key);
+        if (!key_borrowed) {
+            arena_free(parser->arena, new_key);
+        }
         SKIP_WHITESPACES(string);
         if (**string != ',') {
             break;
@@ -762,8 +1296,8 @@ static JSON_Value * parse_object_value(const char **string, size_t nesting) {
         SKIP_WHITESPACES(string);
     }
     SKIP_WHITESPACES(string);
-    if (**string != '}' || /* Trim object after parsing is over */
-        json_object_resize(output_object, json_object_get_count(output_object)) == JSONFailure) {
+    if (**string != '}' || /* Trim object after parsing is over, unless it's in an arena */
+        (parser->arena == NULL && json_object_resize(output_object, json_object_get_count(output_object)) == JSONFailure)) {
             json_value_free(output_value);
             return NULL;
     }
@@ -771,10 +1305,10 @@ static JSON_Value * parse_object_value(const char **string, size_t nesting) {
     return output_value;
 }
 
-static JSON_Value * parse_array_value(const char **string, size_t nesting) {
+static JSON_Value * parse_array_value(JSON_Parser *parser, const char **string, size_t nesting) {
     JSON_Value *output_value = NULL, *new_array_value = NULL;
     JSON_Array *output_array = NULL;
-    output_value = json_value_init_array();
+    output_value = json_value_init_array_arena(parser->arena);
     if (output_value == NULL) {
         return NULL;
     }
@@ -790,7 +1324,7 @@ static JSON_Value * parse_array_value(const char **string, size_t nesting) {
         return output_value;
     }
     while (**string != '\0') {
-        new_array_value = parse_value(string, nesting);
+        new_array_value = parse_value(parser, string, nesting);
         if (new_array_value == NULL) {
             json_value_free(output_value);
             return NULL;
@@ -808,8 +1342,8 @@ static JSON_Value * parse_array_value(const char **string, size_t nesting) {
         SKIP_WHITESPACES(string);
     }
     SKIP_WHITESPACES(string);
-    if (**string != ']' || /* Trim array after parsing is over */
-        json_array_resize(output_array, json_array_get_count(output_array)) == JSONFailure) {
+    if (**string != ']' || /* Trim array after parsing is over, unless it's in an arena */
+        (parser->arena == NULL && json_array_resize(output_array, json_array_get_count(output_array)) == JSONFailure)) {
             json_value_free(output_value);
             return NULL;
     }
@@ -817,34 +1351,40 @@ static JSON_Value * parse_array_value(const char **string, size_t nesting) {
     return output_value;
 }
 
-static JSON_Value * parse_string_value(const char **string) {
+static JSON_Value * parse_string_value(JSON_Parser *parser, const char **string) {
     JSON_Value *value = NULL;
-    char *new_string = get_quoted_string(string);
+    int is_borrowed = 0;
+    char *new_string = get_quoted_string(parser, string, &is_borrowed);
     if (new_string == NULL) {
         return NULL;
     }
-    value = json_value_init_string_no_copy(new_string);
+    value = json_value_init_string_no_copy(parser->arena, new_string);
     if (value == NULL) {
-        parson_free(new_string);
+        if (!is_borrowed) {
+            arena_free(parser->arena, new_string);
+        }
         return NULL;
     }
+    if (is_borrowed) {
+        value->flags |= VALUE_FLAG_BORROWED;
+    }
     return value;
 }
 
-static JSON_Value * parse_boolean_value(const char **string) {
+static JSON_Value * parse_boolean_value(JSON_Parser *parser, const char **string) {
     size_t true_token_size = SIZEOF_TOKEN("true");
     size_t false_token_size = SIZEOF_TOKEN("false");
     if (strncmp("true", *string, true_token_size) == 0) {
         *string += true_token_size;
-        return json_value_init_boolean(1);
+        return json_value_init_boolean_arena(parser->arena, 1);
     } else if (strncmp("false", *string, false_token_size) == 0) {
         *string += false_token_size;
-        return json_value_init_boolean(0);
+        return json_value_init_boolean_arena(parser->arena, 0);
     }
     return NULL;
 }
 
-static JSON_Value * parse_number_value(const char **string) {
+static JSON_Value * parse_number_value(JSON_Parser *parser, const char **string) {
     char *end;
     double number = 0;
     errno = 0;
@@ -853,250 +1393,503 @@ static JSON_Value * parse_number_value(const char **string) {
         return NULL;
     }
     *string = end;
-    return json_value_init_number(number);
+    return json_value_init_number_arena(parser->arena, number);
 }
 
-static JSON_Value * parse_null_value(const char **string) {
+static JSON_Value * parse_null_value(JSON_Parser *parser, const char **string) {
     size_t token_size = SIZEOF_TOKEN("null");
     if (strncmp("null", *string, token_size) == 0) {
         *string += token_size;
-        return json_value_init_null();
+        return json_value_init_null_arena(parser->arena);
     }
     return NULL;
 }
 
+/* Event driven parser */
+#define SAX_EVENT(callback, args) (sax->handler->callback == NULL ? JSONSuccess : sax->handler->callback args)
+
+static JSON_Status sax_parse_value(JSON_Sax_Parser *sax, const char **string, size_t nesting, int build) {
+    JSON_Parser build_parser;
+    JSON_Value *value = NULL;
+    if (nesting > MAX_NESTING) {
+        return JSONFailure;
+    }
+    if (build) { /* strings of built values can't point into input, which goes away after parsing */
+        build_parser.borrow_strings = 0;
+        build_parser.arena = sax->handler->arena;
+        value = parse_value(&build_parser, string, nesting);
+        if (value == NULL) {
+            return JSONFailure;
+        }
+        if (sax->handler->value == NULL) {
+            json_value_free(value);
+            return JSONSuccess;
+        }
+        return sax->handler->value(sax->context, value);
+    }
+    SKIP_WHITESPACES(string);
+    switch (**string) {
+        case '{':
+            return sax_parse_object(sax, string, nesting + 1);
+        case '[':
+            return sax_parse_array(sax, string, nesting + 1);
+        case '\"':
+            return sax_parse_string(sax, string);
+        default:
+            return sax_parse_literal(sax, string);
+    }
+}
+
+static JSON_Status sax_parse_object(JSON_Sax_Parser *sax, const char **string, size_t nesting) {
+    JSON_Status status = JSONFailure;
+    char *new_key = NULL;
+    int key_borrowed = 0;
+    if (**string != '{' || SAX_EVENT(start_object, (sax->context)) != JSONSuccess) {
+        return JSONFailure;
+    }
+    SKIP_CHAR(string);
+    SKIP_WHITESPACES(string);
+    if (**string == '}') { /* empty object */
+        SKIP_CHAR(string);
+        return SAX_EVENT(end_object, (sax->context));
+    }
+    while (**string != '\0') {
+        new_key = get_quoted_string(&sax->parser, string, &key_borrowed);
+        if (new_key == NULL) {
+            return JSONFailure;
+        }
+        SKIP_WHITESPACES(string);
+        if (**string != ':') {
+            if (!key_borrowed) {
+                parson_free(new_key);
+            }
+            return JSONFailure;
+        }
+        SKIP_CHAR(string);
+        status = SAX_EVENT(key, (sax->context, new_key));
+        if (!key_borrowed) {
+            parson_free(new_key);
+        }
+        if (status != JSONSuccess && status != JSONSaxBuildValue) {
+            return JSONFailure;
+        }
+        if (sax_parse_value(sax, string, nesting, status == JSONSaxBuildValue) != JSONSuccess) {
+            return JSONFailure;
+        }
+        SKIP_WHITESPACES(string);
+        if (**string != ',') {
+            break;
+        }
+        SKIP_CHAR(string);
+        SKIP_WHITESPACES(string);
+    }
+    SKIP_WHITESPACES(string);
+    if (**string != '}') {
+        return JSONFailure;
+    }
+    SKIP_CHAR(string);
+    return SAX_EVENT(end_object, (sax->context));
+}
+
+static JSON_Status sax_parse_array(JSON_Sax_Parser *sax, const char **string, size_t nesting) {
+    JSON_Status status = JSONFailure;
+    size_t index = 0;
+    if (**string != '[' || SAX_EVENT(start_array, (sax->context)) != JSONSuccess) {
+        return JSONFailure;
+    }
+    SKIP_CHAR(string);
+    SKIP_WHITESPACES(string);
+    if (**string == ']') { /* empty array */
+        SKIP_CHAR(string);
+        return SAX_EVENT(end_array, (sax->context));
+    }
+    while (**string != '\0') {
+        status = SAX_EVENT(item, (sax->context, index));
+        if (status != JSONSuccess && status != JSONSaxBuildValue) {
+            return JSONFailure;
+        }
+        if (sax_parse_value(sax, string, nesting, status == JSONSaxBuildValue) != JSONSuccess) {
+            return JSONFailure;
+        }
+        index++;
+        SKIP_WHITESPACES(string);
+        if (**string != ',') {
+            break;
+        }
+        SKIP_CHAR(string);
+        SKIP_WHITESPACES(string);
+    }
+    SKIP_WHITESPACES(string);
+    if (**string != ']') {
+        return JSONFailure;
+    }
+    SKIP_CHAR(string);
+    return SAX_EVENT(end_array, (sax->context));
+}
+
+static JSON_Status sax_parse_string(JSON_Sax_Parser *sax, const char **string) {
+    JSON_Status status = JSONFailure;
+    int is_borrowed = 0;
+    char *new_string = get_quoted_string(&sax->parser, string, &is_borrowed);
+    if (new_string == NULL) {
+        return JSONFailure;
+    }
+    status = SAX_EVENT(string, (sax->context, new_string));
+    if (!is_borrowed) {
+        parson_free(new_string);
+    }
+    return status;
+}
+
+/* Numbers, booleans and null */
+static JSON_Status sax_parse_literal(JSON_Sax_Parser *sax, const char **string) {
+    char *end;
+    double number = 0;
+    if (strncmp("true", *string, SIZEOF_TOKEN("true")) == 0) {
+        *string += SIZEOF_TOKEN("true");
+        return SAX_EVENT(boolean, (sax->context, 1));
+    } else if (strncmp("false", *string, SIZEOF_TOKEN("false")) == 0) {
+        *string += SIZEOF_TOKEN("false");
+        return SAX_EVENT(boolean, (sax->context, 0));
+    } else if (strncmp("null", *string, SIZEOF_TOKEN("null")) == 0) {
+        *string += SIZEOF_TOKEN("null");
+        return SAX_EVENT(null, (sax->context));
+    } else if (**string != '-' && !isdigit((unsigned char)**string)) {
+        return JSONFailure;
+    }
+    errno = 0;
+    number = strtod(*string, &end);
+    if (errno || !is_decimal(*string, end - *string)) {
+        return JSONFailure;
+    }
+    *string = end;
+    return SAX_EVENT(number, (sax->context, number));
+}
+
+#undef SAX_EVENT
+
 /* Serialization */
-#define APPEND_STRING(str) do { written = append_string(buf, (str));\
-                                if (written < 0) { return -1; }\
-                                if (buf != NULL) { buf += written; }\
-                                written_total += written; } while(0)
-
-#define APPEND_INDENT(level) do { written = append_indent(buf, (level));\
-                                  if (written < 0) { return -1; }\
-                                  if (buf != NULL) { buf += written; }\
-                                  written_total += written; } while(0)
-
-static int json_serialize_to_buffer_r(const JSON_Value *value, char *buf, int level, int is_pretty, char *num_buf)
-{
+/* Single pass serialization, every value is visited once and written through a JSON_Writer.
+   Strings, files, caller buffers and size calculation all share it. */
+#define WRITE_TOKEN(str) do { if (writer_append(writer, (str), SIZEOF_TOKEN(str)) == JSONFailure) { return JSONFailure; } } while(0)
+#define WRITE_INDENT(level) do { if (writer_append_indent(writer, (level)) == JSONFailure) { return JSONFailure; } } while(0)
+
+static JSON_Status writer_append(JSON_Writer *writer, const char *data, size_t len) {
+    char *new_buf = NULL;
+    size_t new_capacity = 0;
+    if (len == 0) {
+        return JSONSuccess;
+    }
+    if (writer->is_fixed) {
+        if (len > writer->capacity - writer->len) {
+            return JSONFailure;
+        }
+        if (writer->buf != NULL) {
+            memcpy(writer->buf + writer->len, data, len);
+        }
+        writer->len += len;
+        return JSONSuccess;
+    }
+    if (writer->fp != NULL && writer->len + len > writer->capacity) {
+        if (writer_flush(writer) == JSONFailure) {
+            return JSONFailure;
+        }
+        if (len > writer->capacity) { /* doesn't fit in a chunk, write it as is */
+            return fwrite(data, 1, len, writer->fp) == len ? JSONSuccess : JSONFailure;
+        }
+    }
+    if (writer->len + len > writer->capacity) {
+        new_capacity = MAX(writer->capacity * 2, WRITER_STARTING_CAPACITY);
+        while (new_capacity < writer->len + len) {
+            new_capacity *= 2;
+        }
+        new_buf = (char*)parson_malloc(new_capacity);
+        if (new_buf == NULL) {
+            return JSONFailure;
+        }
+        if (writer->buf != NULL && writer->len > 0) {
+            memcpy(new_buf, writer->buf, writer->len);
+        }
+        parson_free(writer->buf);
+        writer->buf = new_buf;
+        writer->capacity = new_capacity;
+    }
+    memcpy(writer->buf + writer->len, data, len);
+    writer->len += len;
+    return JSONSuccess;
+}
+
+static JSON_Status writer_flush(JSON_Writer *writer) {
+    if (writer->len > 0 && fwrite(writer->buf, 1, writer->len, writer->fp) != writer->len) {
+        return JSONFailure;
+    }
+    writer->len = 0;
+    return JSONSuccess;
+}
+
+static JSON_Status writer_append_indent(JSON_Writer *writer, int level) {
+    int i;
+    for (i = 0; i < level; i++) {
+        WRITE_TOKEN("    ");
+    }
+    return JSONSuccess;
+}
+
+/* Keeps number buffer out of recursive json_serialize_to_writer_r stack frames */
+static JSON_Status writer_append_number(JSON_Writer *writer, double number) {
+    char num_buf[NUM_BUF_SIZE];
+    int written = sprintf(num_buf, FLOAT_FORMAT, number);
+    if (written < 0) {
+        return JSONFailure;
+    }
+    return writer_append(writer, num_buf, (size_t)written);
+}
+
+static JSON_Status json_serialize_to_writer_r(const JSON_Value *value, JSON_Writer *writer, int level, int is_pretty) {
     const char *key = NULL, *string = NULL;
-    JSON_Value *temp_value = NULL;
     JSON_Array *array = NULL;
     JSON_Object *object = NULL;
     size_t i = 0, count = 0;
-    double num = 0.0;
-    int written = -1, written_total = 0;
 
     switch (json_value_get_type(value)) {
         case JSONArray:
             array = json_value_get_array(value);
             count = json_array_get_count(array);
-            APPEND_STRING("[");
+            WRITE_TOKEN("[");
             if (count > 0 && is_pretty) {
-                APPEND_STRING("\n");
+                WRITE_TOKEN("\n");
             }
             for (i = 0; i < count; i++) {
                 if (is_pretty) {
-                    APPEND_INDENT(level+1);
-                }
-                temp_value = json_array_get_value(array, i);
-                written = json_serialize_to_buffer_r(temp_value, buf, level+1, is_pretty, num_buf);
-                if (written < 0) {
-                    return -1;
+                    WRITE_INDENT(level+1);
                 }
-                if (buf != NULL) {
-                    buf += written;
+                if (json_serialize_to_writer_r(array->items[i], writer, level+1, is_pretty) == JSONFailure) {
+                    return JSONFailure;
                 }
-                written_total += written;
                 if (i < (count - 1)) {
-                    APPEND_STRING(",");
+                    WRITE_TOKEN(",");
                 }
                 if (is_pretty) {
-                    APPEND_STRING("\n");
+                    WRITE_TOKEN("\n");
                 }
             }
             if (count > 0 && is_pretty) {
-                APPEND_INDENT(level);
+                WRITE_INDENT(level);
             }
-            APPEND_STRING("]");
-            return written_total;
+            WRITE_TOKEN("]");
+            return JSONSuccess;
         case JSONObject:
             object = json_value_get_object(value);
             count  = json_object_get_count(object);
-            APPEND_STRING("{");
+            WRITE_TOKEN("{");
             if (count > 0 && is_pretty) {
-                APPEND_STRING("\n");
+                WRITE_TOKEN("\n");
             }
             for (i = 0; i < count; i++) {
-                key = json_object_get_name(object, i);
+                key = object->names[i];
                 if (key == NULL) {
-                    return -1;
+                    return JSONFailure;
                 }
                 if (is_pretty) {
-                    APPEND_INDENT(level+1);
-                }
-                written = json_serialize_string(key, buf);
-                if (written < 0) {
-                    return -1;
+                    WRITE_INDENT(level+1);
                 }
-                if (buf != NULL) {
-                    buf += written;
+                if (json_serialize_string_to_writer(key, writer) == JSONFailure) {
+                    return JSONFailure;
                 }
-                written_total += written;
-                APPEND_STRING(":");
                 if (is_pretty) {
-                    APPEND_STRING(" ");
-                }
-                temp_value = json_object_get_value(object, key);
-                written = json_serialize_to_buffer_r(temp_value, buf, level+1, is_pretty, num_buf);
-                if (written < 0) {
-                    return -1;
+                    WRITE_TOKEN(": ");
+                } else {
+                    WRITE_TOKEN(":");
                 }
-                if (buf != NULL) {
-                    buf += written;
+                if (json_serialize_to_writer_r(object->values[i], writer, level+1, is_pretty) == JSONFailure) {
+                    return JSONFailure;
                 }
-                written_total += written;
                 if (i < (count - 1)) {
-                    APPEND_STRING(",");
+                    WRITE_TOKEN(",");
                 }
                 if (is_pretty) {
-                    APPEND_STRING("\n");
+                    WRITE_TOKEN("\n");
                 }
             }
             if (count > 0 && is_pretty) {
-                APPEND_INDENT(level);
+                WRITE_INDENT(level);
             }
-            APPEND_STRING("}");
-            return written_total;
+            WRITE_TOKEN("}");
+            return JSONSuccess;
         case JSONString:
             string = json_value_get_string(value);
             if (string == NULL) {
-                return -1;
-            }
-            written = json_serialize_string(string, buf);
-            if (written < 0) {
-                return -1;
-            }
-            if (buf != NULL) {
-                buf += written;
+                return JSONFailure;
             }
-            written_total += written;
-            return written_total;
+            return json_serialize_string_to_writer(string, writer);
         case JSONBoolean:
             if (json_value_get_boolean(value)) {
-                APPEND_STRING("true");
+                WRITE_TOKEN("true");
             } else {
-                APPEND_STRING("false");
+                WRITE_TOKEN("false");
             }
-            return written_total;
+            return JSONSuccess;
         case JSONNumber:
-            num = json_value_get_number(value);
-            if (buf != NULL) {
-                num_buf = buf;
-            }
-            written = sprintf(num_buf, FLOAT_FORMAT, num);
-            if (written < 0) {
-                return -1;
-            }
-            if (buf != NULL) {
-                buf += written;
-            }
-            written_total += written;
-            return written_total;
+            return writer_append_number(writer, json_value_get_number(value));
         case JSONNull:
-            APPEND_STRING("null");
-            return written_total;
+            WRITE_TOKEN("null");
+            return JSONSuccess;
         case JSONError:
-            return -1;
+            return JSONFailure;
         default:
-            return -1;
+            return JSONFailure;
     }
 }
 
-static int json_serialize_string(const char *string, char *buf) {
-    size_t i = 0, len = strlen(string);
+/* Copies runs of characters that need no escaping in one go */
+static JSON_Status json_serialize_string_to_writer(const char *string, JSON_Writer *writer) {
+    const char *run = string, *escaped = NULL;
     char c = '\0';
-    int written = -1, written_total = 0;
-    APPEND_STRING("\"");
-    for (i = 0; i < len; i++) {
-        c = string[i];
+    char escape_buf[8];
+    WRITE_TOKEN("\"");
+    for (; (c = *string) != '\0'; string++) {
         switch (c) {
-            case '\"': APPEND_STRING("\\\""); break;
-            case '\\': APPEND_STRING("\\\\"); break;
-            case '\b': APPEND_STRING("\\b"); break;
-            case '\f': APPEND_STRING("\\f"); break;
-            case '\n': APPEND_STRING("\\n"); break;
-            case '\r': APPEND_STRING("\\r"); break;
-            case '\t': APPEND_STRING("\\t"); break;
-            case '\x00': APPEND_STRING("\\u0000"); break;
-            case '\x01': APPEND_STRING("\\u0001"); break;
-            case '\x02': APPEND_STRING("\\u0002"); break;
-            case '\x03': APPEND_STRING("\\u0003"); break;
-            case '\x04': APPEND_STRING("\\u0004"); break;
-            case '\x05': APPEND_STRING("\\u0005"); break;
-            case '\x06': APPEND_STRING("\\u0006"); break;
-            case '\x07': APPEND_STRING("\\u0007"); break;
-            /* '\x08' duplicate: '\b' */
-            /* '\x09' duplicate: '\t' */
-            /* '\x0a' duplicate: '\n' */
-            case '\x0b': APPEND_STRING("\\u000b"); break;
-            /* '\x0c' duplicate: '\f' */
-            /* '\x0d' duplicate: '\r' */
-            case '\x0e': APPEND_STRING("\\u000e"); break;
-            case '\x0f': APPEND_STRING("\\u000f"); break;
-            case '\x10': APPEND_STRING("\\u0010"); break;
-            case '\x11': APPEND_STRING("\\u0011"); break;
-            case '\x12': APPEND_STRING("\\u0012"); break;
-            case '\x13': APPEND_STRING("\\u0013"); break;
-            case '\x14': APPEND_STRING("\\u0014"); break;
-            case '\x15': APPEND_STRING("\\u0015"); break;
-            case '\x16': APPEND_STRING("\\u0016"); break;
-            case '\x17': APPEND_STRING("\\u0017"); break;
-            case '\x18': APPEND_STRING("\\u0018"); break;
-            case '\x19': APPEND_STRING("\\u0019"); break;
-            case '\x1a': APPEND_STRING("\\u001a"); break;
-            case '\x1b': APPEND_STRING("\\u001b"); break;
-            case '\x1c': APPEND_STRING("\\u001c"); break;
-            case '\x1d': APPEND_STRING("\\u001d"); break;
-            case '\x1e': APPEND_STRING("\\u001e"); break;
-            case '\x1f': APPEND_STRING("\\u001f"); break;
+            case '\"': escaped = "\\\""; break;
+            case '\\': escaped = "\\\\"; break;
+            case '\b': escaped = "\\b"; break;
+            case '\f': escaped = "\\f"; break;
+            case '\n': escaped = "\\n"; break;
+            case '\r': escaped = "\\r"; break;
+            case '\t': escaped = "\\t"; break;
             case '/':
-                if (parson_escape_slashes) {
-                    APPEND_STRING("\\/");  /* to make json embeddable in xml\/html */
-                } else {
-                    APPEND_STRING("/");
+                if (!parson_escape_slashes) {
+                    continue;
                 }
+                escaped = "\\/"; /* to make json embeddable in xml\/html */
                 break;
             default:
-                if (buf != NULL) {
-                    buf[0] = c;
-                    buf += 1;
+                if ((unsigned char)c >= 0x20) {
+                    continue;
                 }
-                written_total += 1;
+                sprintf(escape_buf, "\\u%04x", (unsigned char)c);
+                escaped = escape_buf;
                 break;
         }
+        if (writer_append(writer, run, (size_t)(string - run)) == JSONFailure ||
+            writer_append(writer, escaped, strlen(escaped)) == JSONFailure) {
+            return JSONFailure;
+        }
+        run = string + 1;
+    }
+    if (writer_append(writer, run, (size_t)(string - run)) == JSONFailure) {
+        return JSONFailure;
     }
-    APPEND_STRING("\"");
-    return written_total;
+    WRITE_TOKEN("\"");
+    return JSONSuccess;
 }
 
-static int append_indent(char *buf, int level) {
-    int i;
-    int written = -1, written_total = 0;
-    for (i = 0; i < level; i++) {
-        APPEND_STRING("    ");
+static char * json_serialize_to_string_internal(const JSON_Value *value, int is_pretty) {
+    JSON_Writer writer;
+    writer.buf = NULL;
+    writer.len = 0;
+    writer.capacity = 0;
+    writer.fp = NULL;
+    writer.is_fixed = 0;
+    if (json_serialize_to_writer_r(value, &writer, 0, is_pretty) == JSONFailure ||
+        writer_append(&writer, "", 1) == JSONFailure) { /* null terminator */
+        parson_free(writer.buf);
+        return NULL;
     }
-    return written_total;
+    return writer.buf;
 }
 
-static int append_string(char *buf, const char *string) {
-    if (buf == NULL) {
-        return (int)strlen(string);
+/* Streams output through a fixed size chunk, memory use doesn't depend on document size */
+static JSON_Status json_serialize_to_file_internal(const JSON_Value *value, const char *filename, int is_pretty) {
+    JSON_Status return_code = JSONSuccess;
+    JSON_Writer writer;
+    writer.buf = (char*)parson_malloc(WRITER_CHUNK_SIZE);
+    if (writer.buf == NULL) {
+        return JSONFailure;
+    }
+    writer.len = 0;
+    writer.capacity = WRITER_CHUNK_SIZE;
+    writer.is_fixed = 0;
+    writer.fp = fopen(filename, "w");
+    if (writer.fp == NULL) {
+        parson_free(writer.buf);
+        return JSONFailure;
+    }
+    if (json_serialize_to_writer_r(value, &writer, 0, is_pretty) == JSONFailure ||
+        writer_flush(&writer) == JSONFailure) {
+        return_code = JSONFailure;
+    }
+    if (fclose(writer.fp) == EOF) {
+        return_code = JSONFailure;
+    }
+    parson_free(writer.buf);
+    return return_code;
+}
+
+static size_t json_serialization_size_internal(const JSON_Value *value, int is_pretty) {
+    JSON_Writer writer;
+    writer.buf = NULL;
+    writer.len = 0;
+    writer.capacity = (size_t)-1;
+    writer.fp = NULL;
+    writer.is_fixed = 1;
+    if (json_serialize_to_writer_r(value, &writer, 0, is_pretty) == JSONFailure) {
+        return 0;
+    }
+    return writer.len + 1; /* null terminator */
+}
+
+/* Writes straight into the caller's buffer, fails instead of growing when it runs out */
+static JSON_Status json_serialize_to_buffer_internal(const JSON_Value *value, char *buf, size_t buf_size_in_bytes, int is_pretty) {
+    JSON_Writer writer;
+    if (buf == NULL || buf_size_in_bytes == 0) {
+        return JSONFailure;
+    }
+    writer.buf = buf;
+    writer.len = 0;
+    writer.capacity = buf_size_in_bytes;
+    writer.fp = NULL;
+    writer.is_fixed = 1;
+    if (json_serialize_to_writer_r(value, &writer, 0, is_pretty) == JSONFailure ||
+        writer_append(&writer, "", 1) == JSONFailure) { /* null terminator */
+        return JSONFailure;
+    }
+    return JSONSuccess;
+}
+
+#undef WRITE_TOKEN
+#undef WRITE_INDENT
+
+/* Arena API */
+JSON_Arena * json_arena_init(void) {
+    JSON_Arena *arena = (JSON_Arena*)parson_malloc(sizeof(JSON_Arena));
+    if (arena == NULL) {
+        return NULL;
     }
-    return sprintf(buf, "%s", string);
+    arena->chunks = NULL;
+    arena->next_chunk_size = ARENA_CHUNK_SIZE;
+    arena->mappings = NULL;
+    arena->interned = NULL;
+    arena->interned_count = 0;
+    arena->interned_capacity = 0;
+    return arena;
 }
 
-#undef APPEND_STRING
-#undef APPEND_INDENT
+void json_arena_free(JSON_Arena *arena) {
+    JSON_Arena_Mapping *mapping = NULL;
+    JSON_Arena_Chunk *chunk = NULL, *next_chunk = NULL;
+    if (arena == NULL) {
+        return;
+    }
+    for (mapping = arena->mappings; mapping != NULL; mapping = mapping->next) {
+        unmap_file(mapping->mapping, mapping->mapping_size);
+    }
+    for (chunk = arena->chunks; chunk != NULL; chunk = next_chunk) {
+        next_chunk = chunk->next;
+        parson_free(chunk);
+    }
+    parson_free(arena->interned);
+    parson_free(arena);
+}
 
 /* Parser API */
 JSON_Value * json_parse_file(const char *filename) {
@@ -1110,6 +1903,33 @@ JSON_Value * json_parse_file(const char *filename) {
     return output_value;
 }
 
+JSON_Value * json_parse_file_mmap(const char *filename) {
+    size_t mapping_size = 0;
+    char *mapping = map_file(filename, &mapping_size);
+    const char *string = mapping;
+    JSON_Value *root_value = NULL, *output_value = NULL;
+    JSON_Parser parser;
+    if (mapping == NULL) {
+        return json_parse_file(filename);
+    }
+    parser.borrow_strings = 1;
+    parser.arena = NULL;
+    if (string[0] == '\xEF' && string[1] == '\xBB' && string[2] == '\xBF') {
+        string = string + 3; /* Support for UTF-8 BOM */
+    }
+    root_value = parse_value(&parser, &string, 0);
+    if (root_value != NULL) {
+        output_value = json_value_init_document(root_value, mapping, mapping_size);
+        if (output_value == NULL) {
+            json_value_free(root_value);
+        }
+    }
+    if (output_value == NULL) {
+        unmap_file(mapping, mapping_size);
+    }
+    return output_value;
+}
+
 JSON_Value * json_parse_file_with_comments(const char *filename) {
     char *file_contents = read_file(filename);
     JSON_Value *output_value = NULL;
@@ -1121,19 +1941,67 @@ JSON_Value * json_parse_file_with_comments(const char *filename) {
     return output_value;
 }
 
+JSON_Value * json_parse_file_arena(const char *filename, JSON_Arena *arena) {
+    size_t mapping_size = 0;
+    char *mapping = NULL, *file_contents = NULL;
+    const char *string = NULL;
+    JSON_Arena_Mapping *arena_mapping = NULL;
+    JSON_Value *output_value = NULL;
+    JSON_Parser parser;
+    if (arena == NULL) {
+        return json_parse_file_mmap(filename);
+    }
+    mapping = map_file(filename, &mapping_size);
+    if (mapping == NULL) {
+        file_contents = read_file(filename);
+        if (file_contents == NULL) {
+            return NULL;
+        }
+        output_value = json_parse_string_arena(file_contents, arena);
+        parson_free(file_contents);
+        return output_value;
+    }
+    arena_mapping = (JSON_Arena_Mapping*)arena_malloc(arena, sizeof(JSON_Arena_Mapping));
+    if (arena_mapping == NULL) {
+        unmap_file(mapping, mapping_size);
+        return NULL;
+    }
+    arena_mapping->mapping = mapping;
+    arena_mapping->mapping_size = mapping_size;
+    arena_mapping->next = arena->mappings;
+    arena->mappings = arena_mapping;
+    parser.borrow_strings = 1;
+    parser.arena = arena;
+    string = mapping;
+    if (string[0] == '\xEF' && string[1] == '\xBB' && string[2] == '\xBF') {
+        string = string + 3; /* Support for UTF-8 BOM */
+    }
+    return parse_value(&parser, &string, 0);
+}
+
 JSON_Value * json_parse_string(const char *string) {
+    return json_parse_string_arena(string, NULL);
+}
+
+JSON_Value * json_parse_string_arena(const char *string, JSON_Arena *arena) {
+    JSON_Parser parser;
     if (string == NULL) {
         return NULL;
     }
+    parser.borrow_strings = 0;
+    parser.arena = arena;
     if (string[0] == '\xEF' && string[1] == '\xBB' && string[2] == '\xBF') {
         string = string + 3; /* Support for UTF-8 BOM */
     }
-    return parse_value((const char**)&string, 0);
+    return parse_value(&parser, (const char**)&string, 0);
 }
 
 JSON_Value * json_parse_string_with_comments(const char *string) {
     JSON_Value *result = NULL;
     char *string_mutable_copy = NULL, *string_mutable_copy_ptr = NULL;
+    JSON_Parser parser;
+    parser.borrow_strings = 0;
+    parser.arena = NULL;
     string_mutable_copy = parson_strdup(string);
     if (string_mutable_copy == NULL) {
         return NULL;
@@ -1141,11 +2009,59 @@ JSON_Value * json_parse_string_with_comments(const char *string) {
     remove_comments(string_mutable_copy, "/*", "*/");
     remove_comments(string_mutable_copy, "//", "\n");
     string_mutable_copy_ptr = string_mutable_copy;
-    result = parse_value((const char**)&string_mutable_copy_ptr, 0);
+    result = parse_value(&parser, (const char**)&string_mutable_copy_ptr, 0);
     parson_free(string_mutable_copy);
     return result;
 }
 
+JSON_Status json_sax_parse_file(const char *filename, JSON_Sax_Handler *handler, void *context) {
+    size_t mapping_size = 0;
+    char *mapping = NULL, *file_contents = NULL;
+    const char *string = NULL;
+    JSON_Status status = JSONFailure;
+    JSON_Sax_Parser sax;
+    if (handler == NULL) {
+        return JSONFailure;
+    }
+    mapping = map_file(filename, &mapping_size);
+    if (mapping == NULL) {
+        file_contents = read_file(filename);
+        if (file_contents == NULL) {
+            return JSONFailure;
+        }
+    }
+    sax.parser.borrow_strings = 1; /* both mapping and file_contents are writable */
+    sax.parser.arena = NULL;
+    sax.handler = handler;
+    sax.context = context;
+    string = mapping ? mapping : file_contents;
+    if (string[0] == '\xEF' && string[1] == '\xBB' && string[2] == '\xBF') {
+        string = string + 3; /* Support for UTF-8 BOM */
+    }
+    status = sax_parse_value(&sax, &string, 0, 0);
+    if (mapping != NULL) {
+        unmap_file(mapping, mapping_size);
+    } else {
+        parson_free(file_contents);
+    }
+    return status;
+}
+
+JSON_Status json_sax_parse_string(const char *string, JSON_Sax_Handler *handler, void *context) {
+    JSON_Sax_Parser sax;
+    if (string == NULL || handler == NULL) {
+        return JSONFailure;
+    }
+    sax.parser.borrow_strings = 0;
+    sax.parser.arena = NULL;
+    sax.handler = handler;
+    sax.context = context;
+    if (string[0] == '\xEF' && string[1] == '\xBB' && string[2] == '\xBF') {
+        string = string + 3; /* Support for UTF-8 BOM */
+    }
+    return sax_parse_value(&sax, &string, 0, 0);
+}
+
 /* JSON Object API */
 
 JSON_Value * json_object_get_value(const JSON_Object *object, const char *name) {
@@ -1310,12 +2226,18 @@ JSON_Value * json_value_get_parent (const JSON_Value *value) {
 }
 
 void json_value_free(JSON_Value *value) {
+    JSON_Document *document = NULL;
+    if (value != NULL && (value->flags & VALUE_FLAG_ARENA)) {
+        return; /* released with its arena */
+    }
     switch (json_value_get_type(value)) {
         case JSONObject:
             json_object_free(value->value.object);
             break;
         case JSONString:
-            parson_free(value->value.string);
+            if (!(value->flags & VALUE_FLAG_BORROWED)) {
+                parson_free(value->value.string);
+            }
             break;
         case JSONArray:
             json_array_free(value->value.array);
@@ -1323,40 +2245,70 @@ void json_value_free(JSON_Value *value) {
         default:
             break;
     }
+    if (value != NULL && (value->flags & VALUE_FLAG_DOCUMENT)) {
+        document = (JSON_Document*)value;
+        unmap_file(document->mapping, document->mapping_size);
+    }
     parson_free(value);
 }
 
 JSON_Value * json_value_init_object(void) {
-    JSON_Value *new_value = (JSON_Value*)parson_malloc(sizeof(JSON_Value));
+    return json_value_init_object_arena(NULL);
+}
+
+JSON_Value * json_value_init_array(void) {
+    return json_value_init_array_arena(NULL);
+}
+
+JSON_Value * json_value_init_string(const char *string) {
+    return json_value_init_string_arena(NULL, string);
+}
+
+JSON_Value * json_value_init_number(double number) {
+    return json_value_init_number_arena(NULL, number);
+}
+
+JSON_Value * json_value_init_boolean(int boolean) {
+    return json_value_init_boolean_arena(NULL, boolean);
+}
+
+JSON_Value * json_value_init_null(void) {
+    return json_value_init_null_arena(NULL);
+}
+
+JSON_Value * json_value_init_object_arena(JSON_Arena *arena) {
+    JSON_Value *new_value = (JSON_Value*)arena_malloc(arena, sizeof(JSON_Value));
     if (!new_value) {
         return NULL;
     }
     new_value->parent = NULL;
     new_value->type = JSONObject;
-    new_value->value.object = json_object_init(new_value);
+    new_value->flags = arena ? VALUE_FLAG_ARENA : 0;
+    new_value->value.object = json_object_init(new_value, arena);
     if (!new_value->value.object) {
-        parson_free(new_value);
+        arena_free(arena, new_value);
         return NULL;
     }
     return new_value;
 }
 
-JSON_Value * json_value_init_array(void) {
-    JSON_Value *new_value = (JSON_Value*)parson_malloc(sizeof(JSON_Value));
+JSON_Value * json_value_init_array_arena(JSON_Arena *arena) {
+    JSON_Value *new_value = (JSON_Value*)arena_malloc(arena, sizeof(JSON_Value));
     if (!new_value) {
         return NULL;
     }
     new_value->parent = NULL;
     new_value->type = JSONArray;
-    new_value->value.array = json_array_init(new_value);
+    new_value->flags = arena ? VALUE_FLAG_ARENA : 0;
+    new_value->value.array = json_array_init(new_value, arena);
     if (!new_value->value.array) {
-        parson_free(new_value);
+        arena_free(arena, new_value);
         return NULL;
     }
     return new_value;
 }
 
-JSON_Value * json_value_init_string(const char *string) {
+JSON_Value * json_value_init_string_arena(JSON_Arena *arena, const char *string) {
     char *copy = NULL;
     JSON_Value *value;
     size_t string_len = 0;
@@ -1367,55 +2319,66 @@ JSON_Value * json_value_init_string(const char *string) {
     if (!is_valid_utf8(string, string_len)) {
         return NULL;
     }
-    copy = parson_strndup(string, string_len);
+    if (arena != NULL && string_len <= INTERN_MAX_LENGTH) {
+        copy = (char*)arena_intern(arena, string, string_len, 1);
+    } else {
+        copy = arena_strndup(arena, string, string_len);
+    }
     if (copy == NULL) {
         return NULL;
     }
-    value = json_value_init_string_no_copy(copy);
+    value = json_value_init_string_no_copy(arena, copy);
     if (value == NULL) {
-        parson_free(copy);
+        arena_free(arena, copy);
     }
     return value;
 }
 
-JSON_Value * json_value_init_number(double number) {
+JSON_Value * json_value_init_number_arena(JSON_Arena *arena, double number) {
     JSON_Value *new_value = NULL;
     if (IS_NUMBER_INVALID(number)) {
         return NULL;
     }
-    new_value = (JSON_Value*)parson_malloc(sizeof(JSON_Value));
+    new_value = (JSON_Value*)arena_malloc(arena, sizeof(JSON_Value));
     if (new_value == NULL) {
         return NULL;
     }
     new_value->parent = NULL;
     new_value->type = JSONNumber;
+    new_value->flags = arena ? VALUE_FLAG_ARENA : 0;
     new_value->value.number = number;
     return new_value;
 }
 
-JSON_Value * json_value_init_boolean(int boolean) {
-    JSON_Value *new_value = (JSON_Value*)parson_malloc(sizeof(JSON_Value));
+JSON_Value * json_value_init_boolean_arena(JSON_Arena *arena, int boolean) {
+    JSON_Value *new_value = (JSON_Value*)arena_malloc(arena, sizeof(JSON_Value));
     if (!new_value) {
         return NULL;
     }
     new_value->parent = NULL;
     new_value->type = JSONBoolean;
+    new_value->flags = arena ? VALUE_FLAG_ARENA : 0;
     new_value->value.boolean = boolean ? 1 : 0;
     return new_value;
 }
 
-JSON_Value * json_value_init_null(void) {
-    JSON_Value *new_value = (JSON_Value*)parson_malloc(sizeof(JSON_Value));
+JSON_Value * json_value_init_null_arena(JSON_Arena *arena) {
+    JSON_Value *new_value = (JSON_Value*)arena_malloc(arena, sizeof(JSON_Value));
     if (!new_value) {
         return NULL;
     }
     new_value->parent = NULL;
     new_value->type = JSONNull;
+    new_value->flags = arena ? VALUE_FLAG_ARENA : 0;
     return new_value;
 }
 
 JSON_Value * json_value_deep_copy(const JSON_Value *value) {
-    size_t i = 0;
+    return json_value_deep_copy_arena(value, NULL);
+}
+
+JSON_Value * json_value_deep_copy_arena(const JSON_Value *value, JSON_Arena *arena) {
+    size_t i = 0, string_len = 0;
     JSON_Value *return_value = NULL, *temp_value_copy = NULL, *temp_value = NULL;
     const char *temp_string = NULL, *temp_key = NULL;
     char *temp_string_copy = NULL;
@@ -1425,14 +2388,14 @@ JSON_Value * json_value_deep_copy(const JSON_Value *value) {
     switch (json_value_get_type(value)) {
         case JSONArray:
             temp_array = json_value_get_array(value);
-            return_value = json_value_init_array();
+            return_value = json_value_init_array_arena(arena);
             if (return_value == NULL) {
                 return NULL;
             }
             temp_array_copy = json_value_get_array(return_value);
             for (i = 0; i < json_array_get_count(temp_array); i++) {
                 temp_value = json_array_get_value(temp_array, i);
-                temp_value_copy = json_value_deep_copy(temp_value);
+                temp_value_copy = json_value_deep_copy_arena(temp_value, arena);
                 if (temp_value_copy == NULL) {
                     json_value_free(return_value);
                     return NULL;
@@ -1446,15 +2409,15 @@ JSON_Value * json_value_deep_copy(const JSON_Value *value) {
             return return_value;
         case JSONObject:
             temp_object = json_value_get_object(value);
-            return_value = json_value_init_object();
+            return_value = json_value_init_object_arena(arena);
             if (return_value == NULL) {
                 return NULL;
             }
             temp_object_copy = json_value_get_object(return_value);
             for (i = 0; i < json_object_get_count(temp_object); i++) {
                 temp_key = json_object_get_name(temp_object, i);
-                temp_value = json_object_get_value(temp_object, temp_key);
-                temp_value_copy = json_value_deep_copy(temp_value);
+                temp_value = json_object_get_value_at(temp_object, i);
+                temp_value_copy = json_value_deep_copy_arena(temp_value, arena);
                 if (temp_value_copy == NULL) {
                     json_value_free(return_value);
                     return NULL;
@@ -1467,25 +2430,30 @@ JSON_Value * json_value_deep_copy(const JSON_Value *value) {
             }
             return return_value;
         case JSONBoolean:
-            return json_value_init_boolean(json_value_get_boolean(value));
+            return json_value_init_boolean_arena(arena, json_value_get_boolean(value));
         case JSONNumber:
-            return json_value_init_number(json_value_get_number(value));
+            return json_value_init_number_arena(arena, json_value_get_number(value));
         case JSONString:
             temp_string = json_value_get_string(value);
             if (temp_string == NULL) {
                 return NULL;
             }
-            temp_string_copy = parson_strdup(temp_string);
+            string_len = strlen(temp_string);
+            if (arena != NULL && string_len <= INTERN_MAX_LENGTH) {
+                temp_string_copy = (char*)arena_intern(arena, temp_string, string_len, 1);
+            } else {
+                temp_string_copy = arena_strndup(arena, temp_string, string_len);
+            }
             if (temp_string_copy == NULL) {
                 return NULL;
             }
-            return_value = json_value_init_string_no_copy(temp_string_copy);
+            return_value = json_value_init_string_no_copy(arena, temp_string_copy);
             if (return_value == NULL) {
-                parson_free(temp_string_copy);
+                arena_free(arena, temp_string_copy);
             }
             return return_value;
         case JSONNull:
-            return json_value_init_null();
+            return json_value_init_null_arena(arena);
         case JSONError:
             return NULL;
         default:
@@ -1494,123 +2462,35 @@ JSON_Value * json_value_deep_copy(const JSON_Value *value) {
 }
 
 size_t json_serialization_size(const JSON_Value *value) {
-    char num_buf[NUM_BUF_SIZE]; /* recursively allocating buffer on stack is a bad idea, so let's do it only once */
-    int res = json_serialize_to_buffer_r(value, NULL, 0, 0, num_buf);
-    return res < 0 ? 0 : (size_t)(res) + 1;
+    return json_serialization_size_internal(value, 0);
 }
 
 JSON_Status json_serialize_to_buffer(const JSON_Value *value, char *buf, size_t buf_size_in_bytes) {
-    int written = -1;
-    size_t needed_size_in_bytes = json_serialization_size(value);
-    if (needed_size_in_bytes == 0 || buf_size_in_bytes < needed_size_in_bytes) {
-        return JSONFailure;
-    }
-    written = json_serialize_to_buffer_r(value, buf, 0, 0, NULL);
-    if (written < 0) {
-        return JSONFailure;
-    }
-    return JSONSuccess;
+    return json_serialize_to_buffer_internal(value, buf, buf_size_in_bytes, 0);
 }
 
 JSON_Status json_serialize_to_file(const JSON_Value *value, const char *filename) {
-    JSON_Status return_code = JSONSuccess;
-    FILE *fp = NULL;
-    char *serialized_string = json_serialize_to_string(value);
-    if (serialized_string == NULL) {
-        return JSONFailure;
-    }
-    fp = fopen(filename, "w");
-    if (fp == NULL) {
-        json_free_serialized_string(serialized_string);
-        return JSONFailure;
-    }
-    if (fputs(serialized_string, fp) == EOF) {
-        return_code = JSONFailure;
-    }
-    if (fclose(fp) == EOF) {
-        return_code = JSONFailure;
-    }
-    json_free_serialized_string(serialized_string);
-    return return_code;
+    return json_serialize_to_file_internal(value, filename, 0);
 }
 
 char * json_serialize_to_string(const JSON_Value *value) {
-    JSON_Status serialization_result = JSONFailure;
-    size_t buf_size_bytes = json_serialization_size(value);
-    char *buf = NULL;
-    if (buf_size_bytes == 0) {
-        return NULL;
-    }
-    buf = (char*)parson_malloc(buf_size_bytes);
-    if (buf == NULL) {
-        return NULL;
-    }
-    serialization_result = json_serialize_to_buffer(value, buf, buf_size_bytes);
-    if (serialization_result == JSONFailure) {
-        json_free_serialized_string(buf);
-        return NULL;
-    }
-    return buf;
+    return json_serialize_to_string_internal(value, 0);
 }
 
 size_t json_serialization_size_pretty(const JSON_Value *value) {
-    char num_buf[NUM_BUF_SIZE]; /* recursively allocating buffer on stack is a bad idea, so let's do it only once */
-    int res = json_serialize_to_buffer_r(value, NULL, 0, 1, num_buf);
-    return res < 0 ? 0 : (size_t)(res) + 1;
+    return json_serialization_size_internal(value, 1);
 }
 
 JSON_Status json_serialize_to_buffer_pretty(const JSON_Value *value, char *buf, size_t buf_size_in_bytes) {
-    int written = -1;
-    size_t needed_size_in_bytes = json_serialization_size_pretty(value);
-    if (needed_size_in_bytes == 0 || buf_size_in_bytes < needed_size_in_bytes) {
-        return JSONFailure;
-    }
-    written = json_serialize_to_buffer_r(value, buf, 0, 1, NULL);
-    if (written < 0) {
-        return JSONFailure;
-    }
-    return JSONSuccess;
+    return json_serialize_to_buffer_internal(value, buf, buf_size_in_bytes, 1);
 }
 
 JSON_Status json_serialize_to_file_pretty(const JSON_Value *value, const char *filename) {
-    JSON_Status return_code = JSONSuccess;
-    FILE *fp = NULL;
-    char *serialized_string = json_serialize_to_string_pretty(value);
-    if (serialized_string == NULL) {
-        return JSONFailure;
-    }
-    fp = fopen(filename, "w");
-    if (fp == NULL) {
-        json_free_serialized_string(serialized_string);
-        return JSONFailure;
-    }
-    if (fputs(serialized_string, fp) == EOF) {
-        return_code = JSONFailure;
-    }
-    if (fclose(fp) == EOF) {
-        return_code = JSONFailure;
-    }
-    json_free_serialized_string(serialized_string);
-    return return_code;
+    return json_serialize_to_file_internal(value, filename, 1);
 }
 
 char * json_serialize_to_string_pretty(const JSON_Value *value) {
-    JSON_Status serialization_result = JSONFailure;
-    size_t buf_size_bytes = json_serialization_size_pretty(value);
-    char *buf = NULL;
-    if (buf_size_bytes == 0) {
-        return NULL;
-    }
-    buf = (char*)parson_malloc(buf_size_bytes);
-    if (buf == NULL) {
-        return NULL;
-    }
-    serialization_result = json_serialize_to_buffer_pretty(value, buf, buf_size_bytes);
-    if (serialization_result == JSONFailure) {
-        json_free_serialized_string(buf);
-        return NULL;
-    }
-    return buf;
+    return json_serialize_to_string_internal(value, 1);
 }
 
 void json_free_serialized_string(char *string) {
@@ -1630,7 +2510,8 @@ JSON_Status json_array_remove(JSON_Array *array, size_t ix) {
 }
 
 JSON_Status json_array_replace_value(JSON_Array *array, size_t ix, JSON_Value *value) {
-    if (array == NULL || value == NULL || value->parent != NULL || ix >= json_array_get_count(array)) {
+    if (array == NULL || value == NULL || value->parent != NULL || ix >= json_array_get_count(array) ||
+        !arena_accepts(array->arena, value)) {
         return JSONFailure;
     }
     json_value_free(json_array_get_value(array, ix));
@@ -1640,7 +2521,7 @@ JSON_Status json_array_replace_value(JSON_Array *array, size_t ix, JSON_Value *v
 }
 
 JSON_Status json_array_replace_string(JSON_Array *array, size_t i, const char* string) {
-    JSON_Value *value = json_value_init_string(string);
+    JSON_Value *value = json_value_init_string_arena(json_array_get_arena(array), string);
     if (value == NULL) {
         return JSONFailure;
     }
@@ -1652,7 +2533,7 @@ JSON_Status json_array_replace_string(JSON_Array *array, size_t i, const char* s
 }
 
 JSON_Status json_array_replace_number(JSON_Array *array, size_t i, double number) {
-    JSON_Value *value = json_value_init_number(number);
+    JSON_Value *value = json_value_init_number_arena(json_array_get_arena(array), number);
     if (value == NULL) {
         return JSONFailure;
     }
@@ -1664,7 +2545,7 @@ JSON_Status json_array_replace_number(JSON_Array *array, size_t i, double number
 }
 
 JSON_Status json_array_replace_boolean(JSON_Array *array, size_t i, int boolean) {
-    JSON_Value *value = json_value_init_boolean(boolean);
+    JSON_Value *value = json_value_init_boolean_arena(json_array_get_arena(array), boolean);
     if (value == NULL) {
         return JSONFailure;
     }
@@ -1676,7 +2557,7 @@ JSON_Status json_array_replace_boolean(JSON_Array *array, size_t i, int boolean)
 }
 
 JSON_Status json_array_replace_null(JSON_Array *array, size_t i) {
-    JSON_Value *value = json_value_init_null();
+    JSON_Value *value = json_value_init_null_arena(json_array_get_arena(array));
     if (value == NULL) {
         return JSONFailure;
     }
@@ -1700,14 +2581,14 @@ JSON_Status json_array_clear(JSON_Array *array) {
 }
 
 JSON_Status json_array_append_value(JSON_Array *array, JSON_Value *value) {
-    if (array == NULL || value == NULL || value->parent != NULL) {
+    if (array == NULL || value == NULL || value->parent != NULL || !arena_accepts(array->arena, value)) {
         return JSONFailure;
     }
     return json_array_add(array, value);
 }
 
 JSON_Status json_array_append_string(JSON_Array *array, const char *string) {
-    JSON_Value *value = json_value_init_string(string);
+    JSON_Value *value = json_value_init_string_arena(json_array_get_arena(array), string);
     if (value == NULL) {
         return JSONFailure;
     }
@@ -1719,7 +2600,7 @@ JSON_Status json_array_append_string(JSON_Array *array, const char *string) {
 }
 
 JSON_Status json_array_append_number(JSON_Array *array, double number) {
-    JSON_Value *value = json_value_init_number(number);
+    JSON_Value *value = json_value_init_number_arena(json_array_get_arena(array), number);
     if (value == NULL) {
         return JSONFailure;
     }
@@ -1731,7 +2612,7 @@ JSON_Status json_array_append_number(JSON_Array *array, double number) {
 }
 
 JSON_Status json_array_append_boolean(JSON_Array *array, int boolean) {
-    JSON_Value *value = json_value_init_boolean(boolean);
+    JSON_Value *value = json_value_init_boolean_arena(json_array_get_arena(array), boolean);
     if (value == NULL) {
         return JSONFailure;
     }
@@ -1743,7 +2624,7 @@ JSON_Status json_array_append_boolean(JSON_Array *array, int boolean) {
 }
 
 JSON_Status json_array_append_null(JSON_Array *array) {
-    JSON_Value *value = json_value_init_null();
+    JSON_Value *value = json_value_init_null_arena(json_array_get_arena(array));
     if (value == NULL) {
         return JSONFailure;
     }
@@ -1756,27 +2637,22 @@ JSON_Status json_array_append_null(JSON_Array *array) {
 
 JSON_Status json_object_set_value(JSON_Object *object, const char *name, JSON_Value *value) {
     size_t i = 0;
-    JSON_Value *old_value;
-    if (object == NULL || name == NULL || value == NULL || value->parent != NULL) {
-        return JSONFailure;
-    }
-    old_value = json_object_get_value(object, name);
-    if (old_value != NULL) { /* free and overwrite old value */
-        json_value_free(old_value);
-        for (i = 0; i < json_object_get_count(object); i++) {
-            if (strcmp(object->names[i], name) == 0) {
-                value->parent = json_object_get_wrapping_value(object);
-                object->values[i] = value;
-                return JSONSuccess;
-            }
-        }
+    if (object == NULL || name == NULL || value == NULL || value->parent != NULL || !arena_accepts(object->arena, value)) {
+        return JSONFailure;
+    }
+    i = json_object_getn_index(object, name, strlen(name));
+    if (i != (size_t)-1) { /* free and overwrite old value */
+        json_value_free(object->values[i]);
+        value->parent = json_object_get_wrapping_value(object);
+        object->values[i] = value;
+        return JSONSuccess;
     }
     /* add new key value pair */
     return json_object_add(object, name, value);
 }
 
 JSON_Status json_object_set_string(JSON_Object *object, const char *name, const char *string) {
-    JSON_Value *value = json_value_init_string(string);
+    JSON_Value *value = json_value_init_string_arena(json_object_get_arena(object), string);
     JSON_Status status = json_object_set_value(object, name, value);
     if (status == JSONFailure) {
         json_value_free(value);
@@ -1785,7 +2661,7 @@ JSON_Status json_object_set_string(JSON_Object *object, const char *name, const
 }
 
 JSON_Status json_object_set_number(JSON_Object *object, const char *name, double number) {
-    JSON_Value *value = json_value_init_number(number);
+    JSON_Value *value = json_value_init_number_arena(json_object_get_arena(object), number);
     JSON_Status status = json_object_set_value(object, name, value);
     if (status == JSONFailure) {
         json_value_free(value);
@@ -1794,7 +2670,7 @@ JSON_Status json_object_set_number(JSON_Object *object, const char *name, double
 }
 
 JSON_Status json_object_set_boolean(JSON_Object *object, const char *name, int boolean) {
-    JSON_Value *value = json_value_init_boolean(boolean);
+    JSON_Value *value = json_value_init_boolean_arena(json_object_get_arena(object), boolean);
     JSON_Status status = json_object_set_value(object, name, value);
     if (status == JSONFailure) {
         json_value_free(value);
@@ -1803,7 +2679,7 @@ JSON_Status json_object_set_boolean(JSON_Object *object, const char *name, int b
 }
 
 JSON_Status json_object_set_null(JSON_Object *object, const char *name) {
-    JSON_Value *value = json_value_init_null();
+    JSON_Value *value = json_value_init_null_arena(json_object_get_arena(object));
     JSON_Status status = json_object_set_value(object, name, value);
     if (status == JSONFailure) {
         json_value_free(value);
@@ -1834,7 +2710,7 @@ JSON_Status json_object_dotset_value(JSON_Object *object, const char *name, JSON
         temp_object = json_value_get_object(temp_value);
         return json_object_dotset_value(temp_object, dot_pos + 1, value);
     }
-    new_value = json_value_init_object();
+    new_value = json_value_init_object_arena(object->arena);
     if (new_value == NULL) {
         return JSONFailure;
     }
@@ -1854,7 +2730,7 @@ JSON_Status json_object_dotset_value(JSON_Object *object, const char *name, JSON
 }
 
 JSON_Status json_object_dotset_string(JSON_Object *object, const char *name, const char *string) {
-    JSON_Value *value = json_value_init_string(string);
+    JSON_Value *value = json_value_init_string_arena(json_object_get_arena(object), string);
     if (value == NULL) {
         return JSONFailure;
     }
@@ -1866,7 +2742,7 @@ JSON_Status json_object_dotset_string(JSON_Object *object, const char *name, con
 }
 
 JSON_Status json_object_dotset_number(JSON_Object *object, const char *name, double number) {
-    JSON_Value *value = json_value_init_number(number);
+    JSON_Value *value = json_value_init_number_arena(json_object_get_arena(object), number);
     if (value == NULL) {
         return JSONFailure;
     }
@@ -1878,7 +2754,7 @@ JSON_Status json_object_dotset_number(JSON_Object *object, const char *name, dou
 }
 
 JSON_Status json_object_dotset_boolean(JSON_Object *object, const char *name, int boolean) {
-    JSON_Value *value = json_value_init_boolean(boolean);
+    JSON_Value *value = json_value_init_boolean_arena(json_object_get_arena(object), boolean);
     if (value == NULL) {
         return JSONFailure;
     }
@@ -1890,7 +2766,7 @@ JSON_Status json_object_dotset_boolean(JSON_Object *object, const char *name, in
 }
 
 JSON_Status json_object_dotset_null(JSON_Object *object, const char *name) {
-    JSON_Value *value = json_value_init_null();
+    JSON_Value *value = json_value_init_null_arena(json_object_get_arena(object));
     if (value == NULL) {
         return JSONFailure;
     }
@@ -1915,10 +2791,11 @@ JSON_Status json_object_clear(JSON_Object *object) {
         return JSONFailure;
     }
     for (i = 0; i < json_object_get_count(object); i++) {
-        parson_free(object->names[i]);
+        arena_free(object->arena, object->names[i]);
         json_value_free(object->values[i]);
     }
     object->count = 0;
+    json_object_update_index(object);
     return JSONSuccess;
 }
 
@@ -1965,7 +2842,7 @@ JSON_Status json_validate(const JSON_Value *schema, const JSON_Value *value) {
             }
             for (i = 0; i < count; i++) {
                 key = json_object_get_name(schema_object, i);
-                temp_schema_value = json_object_get_value(schema_object, key);
+                temp_schema_value = json_object_get_value_at(schema_object, i);
                 temp_value = json_object_get_value(value_object, key);
                 if (temp_value == NULL) {
                     return JSONFailure;
@@ -2020,7 +2897,7 @@ int json_value_equals(const JSON_Value *a, const JSON_Value *b) {
             }
             for (i = 0; i < a_count; i++) {
                 key = json_object_get_name(a_object, i);
-                if (!json_value_equals(json_object_get_value(a_object, key),
+                if (!json_value_equals(json_object_get_value_at(a_object, i),
                                        json_object_get_value(b_object, key))) {
                     return 0;
                 }
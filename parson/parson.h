@@ -37,6 +37,7 @@ extern "C"
 typedef struct json_object_t JSON_Object;
 typedef struct json_array_t  JSON_Array;
 typedef struct json_value_t  JSON_Value;
+typedef struct json_arena_t  JSON_Arena;
 
 enum json_value_type {
     JSONError   = -1,
@@ -69,6 +70,26 @@ void json_set_escape_slashes(int escape_slashes);
 /* Parses first JSON value in a file, returns NULL in case of error */
 JSON_Value * json_parse_file(const char *filename);
 
+/* Parses first JSON value in a memory mapped file instead of a copy read into memory. String values
+   without escape sequences point into the mapping, which is released when returned value is freed.
+   Falls back to json_parse_file if file can't be mapped, returns NULL in case of error */
+JSON_Value * json_parse_file_mmap(const char *filename);
+
+/* Arenas
+   Values created in an arena are allocated from large chunks that are all released by json_arena_free,
+   so building or parsing a big document takes a handful of allocations and freeing it doesn't walk it.
+   json_value_free does nothing for values from an arena. Objects and arrays from an arena only accept
+   values from the same arena (json_object_set_value and alike fail otherwise), ordinary ones can hold
+   arena values as long as the arena outlives them. Names and short strings copied into an arena are
+   interned, so repeated ones share a single copy. Arena is not thread safe, use one per thread. */
+JSON_Arena * json_arena_init(void);
+void         json_arena_free(JSON_Arena *arena);
+
+/* Same as json_parse_file_mmap and json_parse_string, but values are allocated from arena.
+   Mapping of parsed file is released together with arena. */
+JSON_Value * json_parse_file_arena(const char *filename, JSON_Arena *arena);
+JSON_Value * json_parse_string_arena(const char *string, JSON_Arena *arena);
+
 /* Parses first JSON value in a file and ignores comments (/ * * / and //),
    returns NULL in case of error */
 JSON_Value * json_parse_file_with_comments(const char *filename);
@@ -80,7 +101,38 @@ JSON_Value * json_parse_string(const char *string);
     returns NULL in case of error */
 JSON_Value * json_parse_string_with_comments(const char *string);
 
-/* Serialization */
+/* Event driven parsing
+   Parses first JSON value and reports it through callbacks instead of building a DOM. Callbacks return
+   JSONSuccess to continue or JSONFailure to stop parsing, NULL callbacks are skipped. Key and item
+   (called before each array element) callbacks can also return JSONSaxBuildValue to receive following
+   value as a whole through value callback, which then owns it. Such values are allocated from arena
+   (which callbacks may change) or with malloc if it's NULL. Strings passed to callbacks are valid only
+   during the call. json_sax_parse_file maps the file when possible, so memory use doesn't depend on
+   its size. */
+enum json_sax_result_t {
+    JSONSaxBuildValue = 1
+};
+
+typedef struct json_sax_handler_t {
+    JSON_Status (*start_object)(void *context);
+    JSON_Status (*end_object)(void *context);
+    JSON_Status (*start_array)(void *context);
+    JSON_Status (*end_array)(void *context);
+    JSON_Status (*key)(void *context, const char *name);
+    JSON_Status (*item)(void *context, size_t index);
+    JSON_Status (*string)(void *context, const char *string);
+    JSON_Status (*number)(void *context, double number);
+    JSON_Status (*boolean)(void *context, int boolean);
+    JSON_Status (*null)(void *context);
+    JSON_Status (*value)(void *context, JSON_Value *value);
+    JSON_Arena   *arena;
+} JSON_Sax_Handler;
+
+JSON_Status json_sax_parse_file(const char *filename, JSON_Sax_Handler *handler, void *context);
+JSON_Status json_sax_parse_string(const char *string, JSON_Sax_Handler *handler, void *context);
+
+/* Serialization
+   Files are written as serialization goes, so a failed call may leave a partially written file. */
 size_t      json_serialization_size(const JSON_Value *value); /* returns 0 on fail */
 JSON_Status json_serialize_to_buffer(const JSON_Value *value, char *buf, size_t buf_size_in_bytes);
 JSON_Status json_serialize_to_file(const JSON_Value *value, const char *filename);
@@ -217,6 +269,15 @@ JSON_Value * json_value_init_null   (void);
 JSON_Value * json_value_deep_copy   (const JSON_Value *value);
 void         json_value_free        (JSON_Value *value);
 
+/* Same as above, but values are allocated from arena (or with malloc if arena is NULL) */
+JSON_Value * json_value_init_object_arena (JSON_Arena *arena);
+JSON_Value * json_value_init_array_arena  (JSON_Arena *arena);
+JSON_Value * json_value_init_string_arena (JSON_Arena *arena, const char *string); /* copies passed string */
+JSON_Value * json_value_init_number_arena (JSON_Arena *arena, double number);
+JSON_Value * json_value_init_boolean_arena(JSON_Arena *arena, int boolean);
+JSON_Value * json_value_init_null_arena   (JSON_Arena *arena);
+JSON_Value * json_value_deep_copy_arena   (const JSON_Value *value, JSON_Arena *arena);
+
 JSON_Value_Type json_value_get_type   (const JSON_Value *value);
 JSON_Object *   json_value_get_object (const JSON_Value *value);
 JSON_Array  *   json_value_get_array  (const JSON_Value *value);